@@ -16,8 +16,27 @@
 
 #include <time.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#endif
+#if defined(__linux__)
+#include <errno.h>
+#include <string.h>
+#include <linux/perf_event.h> // perf_event_attr
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <typeinfo>
 #include <regex>
 #include <algorithm>
 #include <iostream>
@@ -26,6 +45,9 @@
 #include <vector>
 #include <unordered_map>
 #include "tabulate.h"
+#if defined(__GNUG__)
+#include <cxxabi.h> // abi::__cxa_demangle
+#endif
 
 template <typename T>
 inline void DoNotOptimize(T const &value)
@@ -64,6 +86,7 @@ inline void DoNotOptimize(T &value)
         }                                                                                                     \
         prefix##avg = static_cast<double>(__t / N);                                                           \
                                                                                                               \
+        __t = 0;                                                                                              \
         for (unsigned __i = 0; __i < N; __i++) {                                                              \
             double diff = durations[__i] - prefix##avg;                                                       \
             __t += static_cast<long double>(diff * diff);                                                     \
@@ -72,41 +95,465 @@ inline void DoNotOptimize(T &value)
         prefix##stddev = static_cast<double>(sqrt(__t));                                                      \
     } while (0)
 
+/* time stamp counter where the cpu has one (x86, constant rate on recent cpus), 0 elsewhere */
+inline uint64_t ReadCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Group of hardware counters read around a measured loop with perf_event_open, user space only. Events the cpu
+ * or the hypervisor does not provide are left out, and when the group cannot be opened at all (no perf support, or
+ * perf_event_paranoid too high) Available() is false and the values stay NAN.
+ */
+class PerfCounters {
+  public:
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, EVENTS };
+
+    static const char *Name(int event)
+    {
+        static const char *names[EVENTS] = {"core cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+        return names[event];
+    }
+
+    PerfCounters()
+    {
+#if defined(__linux__)
+        const uint32_t types[EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        const uint64_t configs[EVENTS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int e = 0; e < EVENTS; e++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.disabled = leader < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd < 0) {
+                if (e == CYCLES) {
+                    error = errno;
+                    return; // without the leader there is no group
+                }
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[members] = fd;
+            events[members++] = e;
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int i = 0; i < members; i++) close(fds[i]);
+#endif
+    }
+
+    bool Available() const
+    {
+        return leader >= 0;
+    }
+
+    /* why the group could not be opened, for a one line warning */
+    std::string Reason() const
+    {
+#if defined(__linux__)
+        std::string reason = std::string("perf_event_open: ") + strerror(error);
+        FILE *paranoid = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        int level;
+        if (paranoid && fscanf(paranoid, "%d", &level) == 1) {
+            reason += ", perf_event_paranoid = " + std::to_string(level);
+        }
+        if (paranoid) {
+            fclose(paranoid);
+        }
+        return reason;
+#else
+        return "perf_event_open is Linux only";
+#endif
+    }
+
+    void Start()
+    {
+#if defined(__linux__)
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    /* counts since Start(), scaled up when the kernel multiplexed the group; NAN for the missing events */
+    void Stop(double values[EVENTS])
+    {
+        for (int e = 0; e < EVENTS; e++) values[e] = NAN;
+#if defined(__linux__)
+        if (leader < 0) {
+            return;
+        }
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t data[3 + EVENTS];
+        if (read(leader, data, sizeof(data)) < (ssize_t)(3 * sizeof(uint64_t)) || data[2] == 0) {
+            return;
+        }
+        double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        for (uint64_t i = 0; i < data[0] && i < (uint64_t)members; i++) {
+            values[events[i]] = static_cast<double>(data[3 + i]) * scale;
+        }
+#endif
+    }
+
+  private:
+    int leader = -1, error = 0, members = 0;
+    int fds[EVENTS] = {}, events[EVENTS] = {};
+};
+
 class Profiler {
   public:
-    Profiler(const std::string &name, std::function<bool(void)> task, size_t repeat = 0, const size_t N = 5)
+    /**
+     * @brief Robust summary of the per-iteration samples of a benchmark. Samples whose modified z-score
+     * 0.6745 * |x - median| / MAD exceeds 3.5 are outliers (Iglewicz and Hoaglin), the mean, stddev and 95% confidence
+     * interval of the mean (Student's t) are computed without them; median and MAD use every sample.
+     */
+    struct Statistics {
+        size_t samples = 0, outliers = 0;
+        double median = 0, mad = 0, mean = 0, stddev = 0, ci95 = 0;
+
+        static Statistics Of(std::vector<double> values)
+        {
+            Statistics stats;
+            stats.samples = values.size();
+            if (values.empty()) {
+                return stats;
+            }
+            stats.median = Median(values);
+            std::vector<double> deviations;
+            for (double v : values) deviations.push_back(fabs(v - stats.median));
+            stats.mad = Median(deviations);
+
+            std::vector<double> kept;
+            for (double v : values) {
+                if (stats.mad == 0 || 0.6745 * fabs(v - stats.median) / stats.mad <= 3.5) {
+                    kept.push_back(v);
+                }
+            }
+            stats.outliers = values.size() - kept.size();
+            long double sum = 0, squares = 0;
+            for (double v : kept) sum += v;
+            stats.mean = static_cast<double>(sum / kept.size());
+            for (double v : kept) squares += (v - stats.mean) * (v - stats.mean);
+            if (kept.size() > 1) {
+                stats.stddev = static_cast<double>(sqrtl(squares / (kept.size() - 1)));
+                stats.ci95 = StudentT95(kept.size() - 1) * stats.stddev / sqrt(static_cast<double>(kept.size()));
+            }
+            return stats;
+        }
+
+        /* true if the 95% confidence intervals of the two means do not overlap */
+        bool DiffersFrom(const Statistics &other) const
+        {
+            return mean + ci95 < other.mean - other.ci95 || other.mean + other.ci95 < mean - ci95;
+        }
+
+        static double Median(std::vector<double> values)
+        {
+            if (values.empty()) {
+                return 0;
+            }
+            size_t middle = values.size() / 2;
+            std::nth_element(values.begin(), values.begin() + middle, values.end());
+            double upper = values[middle];
+            if (values.size() % 2 != 0) {
+                return upper;
+            }
+            return (*std::max_element(values.begin(), values.begin() + middle) + upper) / 2;
+        }
+
+        /* two-sided 95% critical value of Student's t distribution */
+        static double StudentT95(size_t degrees)
+        {
+            static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                           2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                           2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+            if (degrees == 0) {
+                return 0;
+            }
+            return degrees <= 30 ? table[degrees - 1] : (degrees <= 60 ? 2.000 : (degrees <= 120 ? 1.980 : 1.960));
+        }
+    };
+
+    /* structured parameters of a benchmark in order, e.g. {{"type", "int"}, {"rows", "1000"}} */
+    using Params = std::vector<std::pair<std::string, std::string>>;
+
+    /* a named benchmark argument and the values to run it with */
+    template <typename Arg>
+    struct Argument {
+        std::string name;
+        std::vector<Arg> values;
+    };
+
+    template <typename T>
+    struct Type {
+        using type = T;
+    };
+
+    template <typename... Types>
+    struct TypeList {
+    };
+
+    Profiler(const std::string &name, std::function<bool(void)> task, size_t repeat = 0, const size_t N = 5,
+             size_t warmup = 1)
+        : Profiler(name, Params(), std::move(task), repeat, N, warmup)
     {
-        if (repeat == 0) { // auto checking
+    }
+
+    /**
+     * @brief Time task: after calibrating repeat (when 0) and running warmup rounds of repeat calls that are not
+     * measured, take N samples of repeat calls each. Every sample records nanoseconds per call and, where available,
+     * time stamp counter cycles per call. The benchmark is reported as name(key=value, ...).
+     */
+    Profiler(const std::string &name, const Params &params, std::function<bool(void)> task, size_t repeat = 0,
+             const size_t N = 5, size_t warmup = 1)
+    {
+        const std::string label = Label(name, params);
+        if (repeat == 0 && (repeat = Calibrate(task)) == 0) { // auto checking
+            std::cout << label << ": failed" << std::endl;
+            return;
+        }
+
+        // warm caches, branch predictors and the cpu frequency before measuring
+        for (size_t w = 0; w < warmup; w++) {
+            for (size_t j = 0; j < repeat; j++) {
+                task();
+            }
+        }
+
+        std::unique_ptr<PerfCounters> perf;
+        if (ProfilerCollections::Instance().counters_enabled()) {
+            perf.reset(new PerfCounters());
+            if (!perf->Available()) {
+                ProfilerCollections::Instance().counters_unavailable(perf->Reason());
+                perf.reset();
+            }
+        }
+
+        std::vector<double> durations(N), cycles(N), counts[PerfCounters::EVENTS];
+        for (size_t i = 0; i < N; i++) {
             struct timespec ts, te;
+            if (perf) {
+                perf->Start();
+            }
             clock_gettime(CLOCK_MONOTONIC, &ts);
-            if (!task()) {
-                std::cout << name << ": failed" << std::endl;
-                return;
+            uint64_t cs = ReadCycleCounter();
+            for (size_t j = 0; j < repeat; j++) {
+                task();
             }
+            uint64_t ce = ReadCycleCounter();
             clock_gettime(CLOCK_MONOTONIC, &te);
-
-            time_t delta = (te.tv_sec - ts.tv_sec) * 1'000'000'000 + (te.tv_nsec - ts.tv_nsec);
-            if (delta <= 1000) {
-                repeat = 1000;
-            } else {
-                // Aim for about 100ms between time checks.
-                repeat = 100'000'000 / delta;
-                if (repeat > 1000) {
-                    repeat = 1000;
-                } else if (repeat < 1) {
-                    repeat = 1;
+            if (perf) {
+                double values[PerfCounters::EVENTS];
+                perf->Stop(values);
+                for (int e = 0; e < PerfCounters::EVENTS; e++) {
+                    if (!std::isnan(values[e])) {
+                        counts[e].push_back(values[e] / static_cast<double>(repeat));
+                    }
                 }
             }
+            durations[i] = (static_cast<double>(te.tv_sec - ts.tv_sec) * 1e9
+                            + static_cast<double>(te.tv_nsec - ts.tv_nsec))
+                           / static_cast<double>(repeat);
+            cycles[i] = static_cast<double>(ce - cs) / static_cast<double>(repeat);
         }
 
-        BENCHER(_, task(), N, repeat);
-        ProfilerCollections::Instance().insert(name, _avg, _stddev);
-        std::cout << name << ": avg = " << _avg << ", stddev = " << _stddev << std::endl;
+        Statistics stats = Statistics::Of(durations);
+        double cycles_per_call = Statistics::Median(cycles);
+        std::vector<double> counters(PerfCounters::EVENTS, NAN); /* medians per call */
+        for (int e = 0; e < PerfCounters::EVENTS; e++) {
+            if (!counts[e].empty()) {
+                counters[e] = Statistics::Median(counts[e]);
+            }
+        }
+        ProfilerCollections::Instance().insert(name, params, stats, cycles_per_call, counters);
+        std::cout << label << ": median = " << stats.median << ", mad = " << stats.mad << ", mean = " << stats.mean
+                  << " +- " << stats.ci95 << ", outliers = " << stats.outliers << "/" << stats.samples;
+        if (cycles_per_call > 0) {
+            std::cout << ", cycles = " << cycles_per_call;
+        }
+        for (int e = 0; e < PerfCounters::EVENTS; e++) {
+            if (!std::isnan(counters[e])) {
+                std::cout << ", " << PerfCounters::Name(e) << " = " << counters[e];
+            }
+        }
+        std::cout << std::endl;
+        avg = stats.mean;
+    }
+
+    /* returns average time(nanoseconds) of task without the outliers, or 0 if it failed */
+    static double Add(const std::string &name, std::function<bool(void)> task, size_t repeat = 0, const size_t N = 5,
+                      size_t warmup = 1)
+    {
+        Profiler profiler(name, task, repeat, N, warmup);
+        return profiler.avg;
+    }
+
+    static double Add(const std::string &name, const Params &params, std::function<bool(void)> task, size_t repeat = 0,
+                      const size_t N = 5, size_t warmup = 1)
+    {
+        Profiler profiler(name, params, task, repeat, N, warmup);
+        return profiler.avg;
+    }
+
+    /* lo, lo * multiplier, ... up to hi, e.g. Range("rows", 10, 1000000, 100) for rows in {10, 1e3, 1e5} */
+    static Argument<size_t> Range(const std::string &name, size_t lo, size_t hi, size_t multiplier = 10)
+    {
+        Argument<size_t> argument{name, {}};
+        for (size_t value = lo; value <= hi; value *= multiplier) {
+            argument.values.push_back(value);
+            if (multiplier <= 1 || value > hi / multiplier) {
+                break;
+            }
+        }
+        return argument;
+    }
+
+    template <typename Arg>
+    static Argument<Arg> Values(const std::string &name, std::initializer_list<Arg> values)
+    {
+        return Argument<Arg>{name, values};
+    }
+
+    /**
+     * @brief One benchmark per value of the argument: make(value) sets up and returns the task to time, so the set up
+     * is not measured. Returns the average time of each value, in the order of the values.
+     */
+    template <typename Arg, typename Make>
+    static std::vector<double> Add(const std::string &name, const Argument<Arg> &argument, Make make,
+                                   size_t repeat = 0, const size_t N = 5, size_t warmup = 1)
+    {
+        std::vector<double> avgs;
+        for (auto const &value : argument.values) {
+            Profiler profiler(name, {{argument.name, tabulate::to_string(value)}}, make(value), repeat, N, warmup);
+            avgs.push_back(profiler.avg);
+        }
+        return avgs;
+    }
+
+    /* one benchmark per type, make(Type<T>()) returns the task to time */
+    template <typename... Types, typename Make>
+    static void Add(const std::string &name, TypeList<Types...>, Make make, size_t repeat = 0, const size_t N = 5,
+                    size_t warmup = 1)
+    {
+        auto each = [&](auto type) {
+            using T = typename decltype(type)::type;
+            Profiler profiler(name, {{"type", TypeName<T>()}}, make(type), repeat, N, warmup);
+        };
+        (each(Type<Types>()), ...);
+    }
+
+    /* one benchmark per type and value, make(Type<T>(), value) returns the task to time */
+    template <typename... Types, typename Arg, typename Make>
+    static void Add(const std::string &name, TypeList<Types...>, const Argument<Arg> &argument, Make make,
+                    size_t repeat = 0, const size_t N = 5, size_t warmup = 1)
+    {
+        auto each = [&](auto type) {
+            using T = typename decltype(type)::type;
+            for (auto const &value : argument.values) {
+                Profiler profiler(name, {{"type", TypeName<T>()}, {argument.name, tabulate::to_string(value)}},
+                                  make(type, value), repeat, N, warmup);
+            }
+        };
+        (each(Type<Types>()), ...);
     }
 
-    static void Add(const std::string &name, std::function<bool(void)> task, size_t repeat = 0, const size_t N = 5)
+    /* readable name of T, without inline namespaces such as std::__cxx11 */
+    template <typename T>
+    static std::string TypeName()
     {
-        Profiler profiler(name, task, repeat, N);
+        std::string name = typeid(T).name();
+#if defined(__GNUG__)
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+        if (status == 0 && demangled != nullptr) {
+            name = demangled;
+        }
+        free(demangled);
+#endif
+        return std::regex_replace(name, std::regex("\\b_[_A-Za-z0-9]*::"), "");
+    }
+
+    static std::string Label(const std::string &name, const Params &params)
+    {
+        if (params.empty()) {
+            return name;
+        }
+        std::string label = name + "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            label += (i == 0 ? "" : ", ") + params[i].first + "=" + params[i].second;
+        }
+        return label + ")";
+    }
+
+    /* throughput and per-thread latency of a task run on a number of threads at once */
+    struct Scaling {
+        size_t threads = 0;
+        double throughput = 0; /* calls per second over all threads */
+        double efficiency = 0; /* throughput / (threads * throughput on one thread) */
+        Statistics latency;    /* nanoseconds per call, one sample per thread and round */
+    };
+
+    /**
+     * @brief Run task on 1, 2, 4, ... and finally threads threads (hardware concurrency when 0). For each count, warmup
+     * and then N rounds start all threads from a barrier, each calling task repeat times; a round's throughput is the
+     * calls of all threads over the time from the first start to the last end. Every count is also reported as
+     * name(threads=count) with the per-thread latency, and the scaling table is printed with the summary.
+     */
+    static std::vector<Scaling> AddThreads(const std::string &name, std::function<bool(void)> task, size_t threads = 0,
+                                           size_t repeat = 0, const size_t N = 5, size_t warmup = 1)
+    {
+        if (threads == 0) {
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        if (repeat == 0 && (repeat = Calibrate(task)) == 0) {
+            std::cout << name << ": failed" << std::endl;
+            return {};
+        }
+
+        std::vector<Scaling> scaling;
+        for (size_t count = 1;; count = std::min(count * 2, threads)) {
+            scaling.push_back(RunThreads(task, count, repeat, N, warmup));
+            Scaling &result = scaling.back();
+            result.efficiency = result.throughput / (static_cast<double>(count) * scaling.front().throughput);
+
+            const Params params = {{"threads", std::to_string(count)}};
+            ProfilerCollections::Instance().insert(name, params, result.latency, 0,
+                                                   std::vector<double>(PerfCounters::EVENTS, NAN));
+            std::cout << Label(name, params) << ": throughput = " << result.throughput
+                      << " calls/s, efficiency = " << result.efficiency
+                      << ", latency median = " << result.latency.median << ", mean = " << result.latency.mean << " +- "
+                      << result.latency.ci95 << std::endl;
+            if (count == threads) {
+                break;
+            }
+        }
+        ProfilerCollections::Instance().insert_scaling(name, scaling);
+        return scaling;
     }
 
     static void SetTitle(const std::string &title)
@@ -114,12 +561,177 @@ class Profiler {
         ProfilerCollections::Instance().set_title(title);
     }
 
+    /**
+     * @brief Read cycles, instructions, L1D and LLC misses and branch misses with perf_event_open around the measured
+     * loops of the following benchmarks, shown as IPC and misses per call in the summary. Without access to the
+     * counters a warning is printed once and the benchmarks run as usual.
+     */
+    static void EnableHardwareCounters(bool enable = true)
+    {
+        ProfilerCollections::Instance().enable_counters(enable);
+    }
+
     static void AsReference(const std::string &name)
     {
         ProfilerCollections::Instance().mark_as_ref(name);
     }
 
+    static void AsReference(const std::string &name, const Params &params)
+    {
+        ProfilerCollections::Instance().mark_as_ref(Label(name, params));
+    }
+
+    /* write the results and the environment they were measured in as JSON when finishing */
+    static void WriteJson(const std::string &path)
+    {
+        ProfilerCollections::Instance().set_output(path);
+    }
+
+    /**
+     * @brief Compare the results against a JSON file written by an earlier run when finishing. A benchmark regresses
+     * when its median grew by more than threshold percent and Welch's t-test finds the means differ at 95%.
+     */
+    static void CompareWith(const std::string &baseline, double threshold = 5.0)
+    {
+        ProfilerCollections::Instance().set_baseline(baseline, threshold);
+    }
+
+    /**
+     * @brief Take --json=FILE, --baseline=FILE and --threshold=PERCENT (also as two arguments) out of argv, so the
+     * remaining arguments can be parsed by the benchmark itself.
+     */
+    static void ParseArguments(int &argc, char **argv)
+    {
+        double threshold = 5.0;
+        std::string baseline;
+        int kept = 1;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i], value;
+            auto option = [&](const std::string &flag) -> bool {
+                if (arg.compare(0, flag.size() + 1, flag + "=") == 0) {
+                    value = arg.substr(flag.size() + 1);
+                    return true;
+                }
+                if (arg == flag && i + 1 < argc) {
+                    value = argv[++i];
+                    return true;
+                }
+                return false;
+            };
+            if (option("--json")) {
+                WriteJson(value);
+            } else if (option("--baseline")) {
+                baseline = value;
+            } else if (option("--threshold")) {
+                threshold = strtod(value.c_str(), nullptr);
+            } else {
+                argv[kept++] = argv[i];
+            }
+        }
+        argc = kept;
+        argv[argc] = nullptr;
+        if (!baseline.empty()) {
+            CompareWith(baseline, threshold);
+        }
+    }
+
+    /**
+     * @brief Print the summary tables, write the JSON results and compare them with the baseline, as requested. Returns
+     * the exit code for main: non-zero if any benchmark regressed or the baseline could not be read. Without a call
+     * the tables are printed at exit.
+     */
+    static int Finish()
+    {
+        return ProfilerCollections::Instance().finish();
+    }
+
   private:
+    double avg = 0;
+
+    /* repeat count aiming at about 100ms per sample, 0 if the task failed */
+    static size_t Calibrate(const std::function<bool(void)> &task)
+    {
+        struct timespec ts, te;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        if (!task()) {
+            return 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &te);
+
+        time_t delta = (te.tv_sec - ts.tv_sec) * 1'000'000'000 + (te.tv_nsec - ts.tv_nsec);
+        if (delta <= 1000) {
+            return 1000;
+        }
+        // Aim for about 100ms between time checks.
+        size_t repeat = 100'000'000 / delta;
+        if (repeat > 1000) {
+            repeat = 1000;
+        } else if (repeat < 1) {
+            repeat = 1;
+        }
+        return repeat;
+    }
+
+    static Scaling RunThreads(const std::function<bool(void)> &task, size_t count, size_t repeat, size_t N,
+                              size_t warmup)
+    {
+        const size_t rounds = warmup + N;
+        std::atomic<size_t> arrived(0), generation(0);
+        // the last thread to arrive releases the others, so every round starts in lockstep
+        auto barrier = [&]() {
+            size_t current = generation.load(std::memory_order_acquire);
+            if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                arrived.store(0, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_release);
+            } else {
+                while (generation.load(std::memory_order_acquire) == current) {
+                    std::this_thread::yield();
+                }
+            }
+        };
+        std::vector<struct timespec> starts(rounds * count), ends(rounds * count);
+        auto worker = [&](size_t thread) {
+            for (size_t round = 0; round < rounds; round++) {
+                barrier();
+                clock_gettime(CLOCK_MONOTONIC, &starts[round * count + thread]);
+                for (size_t j = 0; j < repeat; j++) {
+                    task();
+                }
+                clock_gettime(CLOCK_MONOTONIC, &ends[round * count + thread]);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t thread = 1; thread < count; thread++) {
+            workers.emplace_back(worker, thread);
+        }
+        worker(0);
+        for (auto &thread : workers) {
+            thread.join();
+        }
+
+        auto nanoseconds = [](const struct timespec &t) {
+            return static_cast<double>(t.tv_sec) * 1e9 + static_cast<double>(t.tv_nsec);
+        };
+        std::vector<double> latencies, throughputs;
+        for (size_t round = warmup; round < rounds; round++) {
+            double first = INFINITY, last = 0;
+            for (size_t thread = 0; thread < count; thread++) {
+                double start = nanoseconds(starts[round * count + thread]);
+                double end = nanoseconds(ends[round * count + thread]);
+                latencies.push_back((end - start) / static_cast<double>(repeat));
+                first = std::min(first, start);
+                last = std::max(last, end);
+            }
+            throughputs.push_back(static_cast<double>(count * repeat) * 1e9 / std::max(last - first, 1.0));
+        }
+
+        Scaling result;
+        result.threads = count;
+        result.throughput = Statistics::Median(throughputs);
+        result.latency = Statistics::Of(latencies);
+        return result;
+    }
+
     class ProfilerCollections {
       public:
         static ProfilerCollections &Instance()
@@ -128,9 +740,33 @@ class Profiler {
             return instance;
         }
 
-        void insert(const std::string &name, double avg, double stddev)
+        void insert(const std::string &name, const Params &params, const Statistics &stats, double cycles,
+                    const std::vector<double> &counters)
+        {
+            collections.emplace_back(name, params, stats, cycles, counters);
+        }
+
+        void insert_scaling(const std::string &name, const std::vector<Scaling> &rows)
+        {
+            scalings.emplace_back(name, rows);
+        }
+
+        void enable_counters(bool enable)
+        {
+            counters = enable;
+        }
+
+        bool counters_enabled() const
         {
-            collections.emplace_back(name, avg, stddev);
+            return counters;
+        }
+
+        void counters_unavailable(const std::string &reason)
+        {
+            if (!warned) {
+                std::cerr << "hardware counters unavailable (" << reason << "), measuring time only" << std::endl;
+                warned = true;
+            }
         }
 
         void mark_as_ref(const std::string &s)
@@ -139,7 +775,7 @@ class Profiler {
                 return s == another.name;
             });
             if (it != collections.end()) {
-                references.emplace_back(it->name, it->avg, it->stddev);
+                references.push_back(*it);
                 collections.erase(it);
             } else {
                 std::cerr << "Not Found: " << s << std::endl;
@@ -151,14 +787,56 @@ class Profiler {
             this->title = std::move(title);
         }
 
+        void set_output(const std::string &path)
+        {
+            output = path;
+        }
+
+        void set_baseline(const std::string &path, double percent)
+        {
+            baseline = path;
+            threshold = percent;
+        }
+
+        int finish()
+        {
+            if (finished) {
+                return status;
+            }
+            finished = true;
+            print_tables();
+            if (!output.empty() && !write_json(output)) {
+                std::cerr << "Cannot write " << output << std::endl;
+                status = 1;
+            }
+            if (!baseline.empty()) {
+                status |= compare_with_baseline();
+            }
+            return status;
+        }
+
       private:
         struct ProfileData {
-            double avg;
-            double stddev;
-            std::string name;
+            Statistics stats;
+            double cycles;                /* per call, 0 without a cycle counter */
+            std::vector<double> counters; /* PerfCounters events per call, NAN when not measured */
+            std::string name, base;       /* name(key=value, ...) and name */
+            Params params;
             std::vector<std::string> keys;
-            ProfileData(const std::string &name_, double avg_, double stddev_) : avg(avg_), stddev(stddev_), name(name_)
+            ProfileData(const std::string &name_, const Params &params_, const Statistics &stats_, double cycles_,
+                        const std::vector<double> &counters_)
+                : stats(stats_), cycles(cycles_), counters(counters_), name(Label(name_, params_)), base(name_),
+                  params(params_)
             {
+                if (!params.empty()) {
+                    keys.push_back(name_);
+                    for (auto const &param : params) {
+                        keys.push_back(param.first + "=" + param.second);
+                    }
+                    return;
+                }
+
+                // plain names like "sort(quick, 1000)" are split into words
                 std::regex pattern("([\\w\\-]+)");
                 auto key_end = std::sregex_iterator();
                 auto key_begin = std::sregex_iterator(name_.begin(), name_.end(), pattern);
@@ -166,30 +844,149 @@ class Profiler {
                 for (auto it = key_begin; it != key_end; ++it) {
                     keys.push_back(it->str());
                 }
+                if (keys.empty()) {
+                    keys.push_back(name_);
+                }
+                base = keys[0];
             }
         };
-        std::string title;
+        std::string title, output, baseline;
+        double threshold = 5.0; /* percent */
+        bool counters = false, warned = false, finished = false;
+        int status = 0;
         std::vector<ProfileData> references;
         std::vector<ProfileData> collections;
+        std::vector<std::pair<std::string, std::vector<Scaling>>> scalings;
+
+        static std::string Format(double value, int precision)
+        {
+            char text[64];
+            snprintf(text, sizeof(text), "%.*f", precision, value);
+            return text;
+        }
+
+        /* mean +- half width, and the half width relative to the mean */
+        static std::string Interval(const Statistics &stats)
+        {
+            return Format(stats.mean, 2) + " +- " + Format(stats.ci95, 2) + " ("
+                   + Format(stats.mean > 0 ? 100 * stats.ci95 / stats.mean : 0, 1) + "%)";
+        }
+
+        /* hardware counter columns appended to every row, when any benchmark has them */
+        bool has_counters() const
+        {
+            for (auto const &v : collections) {
+                for (double c : v.counters) {
+                    if (!std::isnan(c)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        static std::vector<std::string> Counters(const ProfileData &v)
+        {
+            auto cell = [&](int event, int precision) -> std::string {
+                return std::isnan(v.counters[event]) ? std::string("N/A") : Format(v.counters[event], precision);
+            };
+            std::string ipc = "N/A";
+            if (!std::isnan(v.counters[PerfCounters::CYCLES]) && !std::isnan(v.counters[PerfCounters::INSTRUCTIONS])
+                && v.counters[PerfCounters::CYCLES] > 0) {
+                ipc = Format(v.counters[PerfCounters::INSTRUCTIONS] / v.counters[PerfCounters::CYCLES], 2);
+            }
+            return {ipc, cell(PerfCounters::L1D_MISSES, 2), cell(PerfCounters::LLC_MISSES, 2),
+                    cell(PerfCounters::BRANCH_MISSES, 2)};
+        }
+
+        /* benchmarks of the same name next to each other, in the order they first ran */
+        std::vector<const ProfileData *> grouped() const
+        {
+            std::vector<const ProfileData *> rows;
+            std::map<std::string, size_t> first;
+            for (auto const &v : collections) {
+                first.emplace(v.base, first.size());
+                rows.push_back(&v);
+            }
+            std::stable_sort(rows.begin(), rows.end(), [&](const ProfileData *a, const ProfileData *b) {
+                return first[a->base] < first[b->base];
+            });
+            return rows;
+        }
+
+        /* parameter names over all benchmarks, in the order they first appear */
+        std::vector<std::string> parameters() const
+        {
+            std::vector<std::string> names;
+            for (auto const &v : collections) {
+                for (auto const &param : v.params) {
+                    if (std::find(names.begin(), names.end(), param.first) == names.end()) {
+                        names.push_back(param.first);
+                    }
+                }
+            }
+            return names;
+        }
+
+        /* the reference of the same name sharing the most parameter values with v */
+        const ProfileData *reference_of(const ProfileData &v) const
+        {
+            const ProfileData *best = nullptr;
+            long best_shared = -1;
+            for (auto const &ref : references) {
+                if (ref.base != v.base) {
+                    continue;
+                }
+                long shared = 0;
+                for (auto const &param : ref.params) {
+                    shared += std::count(v.params.begin(), v.params.end(), param);
+                }
+                if (shared > best_shared) {
+                    best = &ref;
+                    best_shared = shared;
+                }
+            }
+            return best;
+        }
 
         void make_summary_table(tabulate::Table &table)
         {
+            const bool counters = has_counters();
+            const std::vector<std::string> names = parameters();
+            auto add = [&](std::vector<std::string> cells, const ProfileData *v) -> tabulate::Row & {
+                if (counters) {
+                    std::vector<std::string> extra = v ? Counters(*v)
+                                                       : std::vector<std::string>{"IPC", "L1D misses", "LLC misses",
+                                                                                  "branch misses"};
+                    cells.insert(cells.end(), extra.begin(), extra.end());
+                }
+                return table.add_multiple(cells);
+            };
+            auto str = [](double value) -> std::string {
+                return tabulate::to_string(value);
+            };
+
             if (references.size() == 0) {
-                table.add("description", "average time(nanoseconds)", "coefficient of variation");
+                // one column per parameter, so a benchmark's rows read as a series
+                std::vector<std::string> header = {"description"};
+                header.insert(header.end(), names.begin(), names.end());
+                for (auto const &column : {"median time(nanoseconds)", "MAD", "95% CI of mean", "outliers", "cycles"}) {
+                    header.push_back(column);
+                }
+                add(header, nullptr);
             } else {
-                table.add("description", "average time", "average time(reference)", "coefficient of variation",
-                          "perfermance ratio");
+                add({"description", "median time", "median time(reference)", "95% CI of mean", "performance ratio"},
+                    nullptr);
             }
 
             int i = 0;
-            for (auto const &v : collections) {
+            for (const ProfileData *row : grouped()) {
+                const ProfileData &v = *row;
+                i++;
                 if (references.size() != 0) {
-                    auto ref =
-                        std::find_if(references.begin(), references.end(), [&](const ProfileData &another) -> bool {
-                            return v.keys[0] == another.keys[0];
-                        });
-                    if (ref != references.end()) {
-                        double diff = ref->avg / v.avg;
+                    const ProfileData *ref = reference_of(v);
+                    if (ref != nullptr) {
+                        double diff = ref->stats.median / v.stats.median;
 
                         std::string name = v.keys[0] + "(";
                         if (v.keys.size() > 2) {
@@ -220,10 +1017,12 @@ class Profiler {
                             name += ")";
                         }
                         name += ")";
-                        table.add(name, v.avg, ref->avg, v.stddev / v.avg, diff);
+                        add({name, str(v.stats.median), str(ref->stats.median), Interval(v.stats), str(diff)}, &v);
 
-                        i++;
-                        if (diff >= 1.2) {
+                        // only a difference beyond both confidence intervals is colored
+                        if (!v.stats.DiffersFrom(ref->stats)) {
+                            table[i][4].format().styles(tabulate::Style::italic);
+                        } else if (diff >= 1.2) {
                             table[i][4].format().color(tabulate::Color::green);
                             if (diff >= 2.0) {
                                 table[i][4].format().styles(tabulate::Style::bold);
@@ -241,22 +1040,429 @@ class Profiler {
                             }
                         }
                     } else {
-                        auto &row = table.add(v.name, v.avg, "No Reference", v.stddev / v.avg, "N/A");
+                        auto &row = add({v.name, str(v.stats.median), "No Reference", Interval(v.stats), "N/A"}, &v);
                         row[2].format().styles(tabulate::Style::italic);
                     }
                 } else {
-                    table.add(v.name, v.avg, v.stddev / v.avg);
+                    std::vector<std::string> cells = {v.params.empty() ? v.name : v.base};
+                    for (auto const &column : names) {
+                        auto param = std::find_if(v.params.begin(), v.params.end(), [&](const Params::value_type &p) {
+                            return p.first == column;
+                        });
+                        cells.push_back(param != v.params.end() ? param->second : "");
+                    }
+                    for (auto const &cell : {str(v.stats.median), str(v.stats.mad), Interval(v.stats),
+                                             std::to_string(v.stats.outliers) + "/" + std::to_string(v.stats.samples),
+                                             v.cycles > 0 ? Format(v.cycles, 1) : std::string("N/A")}) {
+                        cells.push_back(cell);
+                    }
+                    add(cells, &v);
                 }
             }
             table.format().align(tabulate::Align::center);
         }
 
-        ProfilerCollections() {}
-        ~ProfilerCollections()
+        static std::string Escape(const std::string &text)
+        {
+            std::string escaped;
+            for (unsigned char c : text) {
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                    escaped += static_cast<char>(c);
+                } else if (c < 0x20) {
+                    char code[8];
+                    snprintf(code, sizeof(code), "\\u%04x", c);
+                    escaped += code;
+                } else {
+                    escaped += static_cast<char>(c);
+                }
+            }
+            return "\"" + escaped + "\"";
+        }
+
+        /* JSON has no NAN */
+        static std::string Number(double value)
         {
+            if (std::isnan(value) || std::isinf(value)) {
+                return "null";
+            }
+            char text[64];
+            snprintf(text, sizeof(text), "%.17g", value);
+            return text;
+        }
+
+        static std::string Compiler()
+        {
+#if defined(__clang__)
+            return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+            return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+            return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+            return "unknown";
+#endif
+        }
+
+        /* the build flags that can be told from predefined macros, or PROFILER_FLAGS when the build passes them */
+        static std::string Flags()
+        {
+#if defined(PROFILER_FLAGS)
+            return PROFILER_FLAGS;
+#else
+            std::string flags = "-std=c++" + std::to_string(__cplusplus / 100 % 100);
+#if defined(__OPTIMIZE_SIZE__)
+            flags += " -Os";
+#elif defined(__OPTIMIZE__)
+            flags += " -O";
+#else
+            flags += " -O0";
+#endif
+#if defined(NDEBUG)
+            flags += " -DNDEBUG";
+#endif
+#if defined(__AVX512F__)
+            flags += " -mavx512f";
+#elif defined(__AVX2__)
+            flags += " -mavx2";
+#elif defined(__SSE4_2__)
+            flags += " -msse4.2";
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+            flags += " -fsanitize=address";
+#endif
+#if defined(__SANITIZE_THREAD__)
+            flags += " -fsanitize=thread";
+#endif
+            return flags;
+#endif
+        }
+
+        static std::string CpuModel()
+        {
+            std::ifstream cpuinfo("/proc/cpuinfo");
+            std::string line;
+            while (std::getline(cpuinfo, line)) {
+                if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0) {
+                    size_t colon = line.find(':');
+                    if (colon != std::string::npos) {
+                        return tabulate::lstrip(line.substr(colon + 1));
+                    }
+                }
+            }
+            return "unknown";
+        }
+
+        bool write_json(const std::string &path)
+        {
+            std::ofstream json(path);
+            if (!json) {
+                return false;
+            }
+            char date[32] = "";
+            time_t now = time(nullptr);
+            struct tm tm;
+            if (gmtime_r(&now, &tm)) {
+                strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+            }
+            json << "{\n  \"title\": " << Escape(title) << ",\n  \"context\": {\n    \"date\": " << Escape(date)
+                 << ",\n    \"cpu\": " << Escape(CpuModel()) << ",\n    \"cpus\": "
+                 << std::thread::hardware_concurrency() << ",\n    \"compiler\": " << Escape(Compiler())
+                 << ",\n    \"flags\": " << Escape(Flags()) << "\n  },\n  \"benchmarks\": [";
+            std::vector<const ProfileData *> all;
+            for (auto const &v : references) all.push_back(&v);
+            for (auto const &v : collections) all.push_back(&v);
+            for (size_t i = 0; i < all.size(); i++) {
+                const ProfileData &v = *all[i];
+                json << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << Escape(v.name)
+                     << ", \"median\": " << Number(v.stats.median) << ", \"mad\": " << Number(v.stats.mad)
+                     << ", \"mean\": " << Number(v.stats.mean) << ", \"stddev\": " << Number(v.stats.stddev)
+                     << ", \"ci95\": " << Number(v.stats.ci95) << ", \"samples\": " << v.stats.samples
+                     << ", \"outliers\": " << v.stats.outliers << ", \"cycles\": " << Number(v.cycles);
+                if (!v.params.empty()) {
+                    json << ", \"params\": {";
+                    for (size_t p = 0; p < v.params.size(); p++) {
+                        json << (p == 0 ? "" : ", ") << Escape(v.params[p].first) << ": " << Escape(v.params[p].second);
+                    }
+                    json << "}";
+                }
+                for (size_t e = 0; e < v.counters.size(); e++) {
+                    if (std::isnan(v.counters[e])) {
+                        continue;
+                    }
+                    json << ", " << Escape(PerfCounters::Name(static_cast<int>(e))) << ": " << Number(v.counters[e]);
+                }
+                json << "}";
+            }
+            json << "\n  ]\n}\n";
+            return static_cast<bool>(json);
+        }
+
+        /**
+         * @brief Just enough of a JSON reader for the files written above: the statistics of every object in the
+         * "benchmarks" array, by name. Anything else is skipped.
+         */
+        class JsonScanner {
+          public:
+            explicit JsonScanner(const std::string &text_) : text(text_) {}
+
+            bool benchmarks(std::map<std::string, Statistics> &results)
+            {
+                if (!consume('{')) {
+                    return false;
+                }
+                while (!consume('}')) {
+                    std::string key;
+                    if (!string(key) || !consume(':')) {
+                        return false;
+                    }
+                    if (key != "benchmarks") {
+                        if (!skip()) {
+                            return false;
+                        }
+                    } else {
+                        if (!consume('[')) {
+                            return false;
+                        }
+                        while (!consume(']')) {
+                            std::string name;
+                            Statistics stats;
+                            if (!benchmark(name, stats)) {
+                                return false;
+                            }
+                            results[name] = stats;
+                            consume(',');
+                        }
+                    }
+                    consume(',');
+                }
+                return true;
+            }
+
+          private:
+            const std::string &text;
+            size_t pos = 0;
+
+            bool consume(char c)
+            {
+                while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos]))) pos++;
+                if (pos < text.size() && text[pos] == c) {
+                    pos++;
+                    return true;
+                }
+                return false;
+            }
+
+            bool string(std::string &value)
+            {
+                if (!consume('"')) {
+                    return false;
+                }
+                value.clear();
+                while (pos < text.size() && text[pos] != '"') {
+                    if (text[pos] == '\\' && pos + 1 < text.size()) {
+                        pos++;
+                        if (text[pos] == 'u' && pos + 4 < text.size()) {
+                            value += static_cast<char>(strtol(text.substr(pos + 1, 4).c_str(), nullptr, 16));
+                            pos += 4;
+                        } else {
+                            value += text[pos] == 'n' ? '\n' : (text[pos] == 't' ? '\t' : text[pos]);
+                        }
+                    } else {
+                        value += text[pos];
+                    }
+                    pos++;
+                }
+                return consume('"');
+            }
+
+            bool number(double &value)
+            {
+                consume(' ');
+                if (text.compare(pos, 4, "null") == 0) {
+                    pos += 4;
+                    value = NAN;
+                    return true;
+                }
+                const char *begin = text.c_str() + pos;
+                char *end;
+                value = strtod(begin, &end);
+                pos += static_cast<size_t>(end - begin);
+                return end != begin;
+            }
+
+            bool benchmark(std::string &name, Statistics &stats)
+            {
+                if (!consume('{')) {
+                    return false;
+                }
+                while (!consume('}')) {
+                    std::string key;
+                    double value = 0;
+                    if (!string(key) || !consume(':')) {
+                        return false;
+                    }
+                    bool ok = true;
+                    if (key == "name") {
+                        ok = string(name);
+                    } else if (key == "median" || key == "mad" || key == "mean" || key == "stddev" || key == "ci95"
+                               || key == "samples" || key == "outliers") {
+                        ok = number(value);
+                        double *fields[] = {&stats.median, &stats.mad, &stats.mean, &stats.stddev, &stats.ci95};
+                        const char *names[] = {"median", "mad", "mean", "stddev", "ci95"};
+                        for (int f = 0; f < 5; f++) {
+                            if (key == names[f]) {
+                                *fields[f] = value;
+                            }
+                        }
+                        if (key == "samples") {
+                            stats.samples = static_cast<size_t>(value);
+                        } else if (key == "outliers") {
+                            stats.outliers = static_cast<size_t>(value);
+                        }
+                    } else {
+                        ok = skip();
+                    }
+                    if (!ok) {
+                        return false;
+                    }
+                    consume(',');
+                }
+                return true;
+            }
+
+            /* any value: strings, numbers and literals, nested objects and arrays */
+            bool skip()
+            {
+                std::string ignored;
+                double value;
+                if (consume('{') || consume('[')) {
+                    char open = text[pos - 1], close = open == '{' ? '}' : ']';
+                    while (!consume(close)) {
+                        if (open == '{' && (!string(ignored) || !consume(':'))) {
+                            return false;
+                        }
+                        if (!skip()) {
+                            return false;
+                        }
+                        consume(',');
+                    }
+                    return true;
+                }
+                consume(' ');
+                if (pos < text.size() && text[pos] == '"') {
+                    return string(ignored);
+                }
+                if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 4, "null") == 0) {
+                    pos += 4;
+                    return true;
+                }
+                if (text.compare(pos, 5, "false") == 0) {
+                    pos += 5;
+                    return true;
+                }
+                return number(value);
+            }
+        };
+
+        /* Welch's t-test on the means without outliers, at 95% */
+        static bool Significant(const Statistics &a, const Statistics &b)
+        {
+            double na = static_cast<double>(a.samples - a.outliers), nb = static_cast<double>(b.samples - b.outliers);
+            if (na < 2 || nb < 2) {
+                return a.DiffersFrom(b);
+            }
+            double va = a.stddev * a.stddev / na, vb = b.stddev * b.stddev / nb;
+            if (va + vb == 0) {
+                return a.mean != b.mean;
+            }
+            double t = fabs(a.mean - b.mean) / sqrt(va + vb);
+            double degrees = (va + vb) * (va + vb) / (va * va / (na - 1) + vb * vb / (nb - 1));
+            return t > Statistics::StudentT95(static_cast<size_t>(std::max(degrees, 1.0)));
+        }
+
+        /* print the deltas against the baseline, returns 1 on a regression or an unreadable baseline */
+        int compare_with_baseline()
+        {
+            std::ifstream file(baseline);
+            std::stringstream text;
+            text << file.rdbuf();
+            std::map<std::string, Statistics> before;
+            if (!file || !JsonScanner(text.str()).benchmarks(before)) {
+                std::cerr << "Cannot read baseline " << baseline << std::endl;
+                return 1;
+            }
+
             tabulate::Table table;
+            table.set_title("Comparison with " + baseline + " (threshold " + Format(threshold, 1) + "%)");
+            table.add("description", "median time(baseline)", "median time", "delta", "significant", "verdict");
+            int regressions = 0;
+            std::vector<const ProfileData *> all;
+            for (auto const &v : references) all.push_back(&v);
+            for (auto const &v : collections) all.push_back(&v);
+            for (const ProfileData *v : all) {
+                auto it = before.find(v->name);
+                if (it == before.end()) {
+                    table.add(v->name, "N/A", v->stats.median, "N/A", "N/A", "new");
+                    continue;
+                }
+                const Statistics &old = it->second;
+                double delta = old.median > 0 ? 100 * (v->stats.median - old.median) / old.median : 0;
+                bool significant = Significant(v->stats, old);
+                std::string verdict = "unchanged";
+                if (significant && delta > threshold) {
+                    verdict = "regression";
+                    regressions++;
+                } else if (significant && delta < -threshold) {
+                    verdict = "improvement";
+                }
+                auto &row = table.add(v->name, old.median, v->stats.median, Format(delta, 1) + "%",
+                                      significant ? "yes" : "no", verdict);
+                if (verdict == "regression") {
+                    row[5].format().color(tabulate::Color::red).styles(tabulate::Style::bold);
+                } else if (verdict == "improvement") {
+                    row[5].format().color(tabulate::Color::green);
+                }
+            }
+            table.format().align(tabulate::Align::center);
+            std::cout << table.xterm() << std::endl;
+            if (regressions != 0) {
+                std::cerr << regressions << " benchmark(s) regressed by more than " << threshold << "% against "
+                          << baseline << std::endl;
+            }
+            return regressions != 0 ? 1 : 0;
+        }
+
+        void make_scaling_table(tabulate::Table &table)
+        {
+            table.add("description", "threads", "throughput(calls/s)", "speedup", "efficiency",
+                      "median latency(nanoseconds)", "95% CI of latency");
+            int i = 0;
+            for (auto const &scaling : scalings) {
+                for (auto const &s : scaling.second) {
+                    i++;
+                    table.add(scaling.first, s.threads, Format(s.throughput, 0),
+                              Format(s.throughput / scaling.second.front().throughput, 2), Format(s.efficiency, 2),
+                              s.latency.median, Interval(s.latency));
+                    if (s.efficiency >= 0.9) {
+                        table[i][4].format().color(tabulate::Color::green);
+                    } else if (s.efficiency < 0.5) {
+                        table[i][4].format().color(tabulate::Color::red);
+                    }
+                }
+            }
+            table.format().align(tabulate::Align::center);
+        }
+
+        void print_tables()
+        {
+            tabulate::Table table, scaling;
             table.set_title(title);
             make_summary_table(table);
+            if (!scalings.empty()) {
+                scaling.set_title("Scaling of " + title);
+                make_scaling_table(scaling);
+            }
 
             /**
              * output all supported format, and you can catch one or more via
@@ -266,15 +1472,30 @@ class Profiler {
              */
             std::cout << "-----BEGIN XTERM TABLE-----" << std::endl;
             std::cout << table.xterm() << std::endl;
+            if (!scalings.empty()) {
+                std::cout << scaling.xterm() << std::endl;
+            }
             std::cout << "-----END XTERM TABLE-----" << std::endl;
 
             std::cout << "-----BEGIN MARKDOWN TABLE-----" << std::endl;
             std::cout << table.markdown() << std::endl;
+            if (!scalings.empty()) {
+                std::cout << scaling.markdown() << std::endl;
+            }
             std::cout << "-----END MARKDOWN TABLE-----" << std::endl;
 
             std::cout << "-----BEGIN LATEX TABLE-----" << std::endl;
             std::cout << table.latex() << std::endl;
+            if (!scalings.empty()) {
+                std::cout << scaling.latex() << std::endl;
+            }
             std::cout << "-----END LATEX TABLE-----" << std::endl;
         }
+
+        ProfilerCollections() {}
+        ~ProfilerCollections()
+        {
+            finish();
+        }
     };
 };
@@ -0,0 +1,177 @@
+/**
+ * Copyright 2022 Kiran Nowak(kiran.nowak@gmail.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "profiler.h"
+
+/* heap profile: count allocations and bytes requested through global operator new */
+static std::atomic<size_t> heap_allocations(0);
+static std::atomic<size_t> heap_bytes(0);
+
+void *operator new(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// not inlined, otherwise GCC pairs the inlined free() with operator new and reports a mismatch
+__attribute__((noinline)) void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace tabulate;
+
+static Table results;
+
+/**
+ * Benchmark a task for each value of the argument: make(value) returns the task, ops(value) the number of operations
+ * it performs. Time comes from Profiler, heap usage from one extra run between two snapshots of the counters. All
+ * values are reported per operation.
+ */
+template <typename Make>
+static void bench(const std::string &name, const Profiler::Argument<size_t> &argument, Make make,
+                  std::function<size_t(size_t)> ops = [](size_t) {
+                      return 1;
+                  })
+{
+    std::vector<std::pair<size_t, size_t>> heap;
+    std::vector<double> avgs = Profiler::Add(
+        name, argument,
+        [&](size_t value) {
+            std::function<void(void)> task = make(value);
+            size_t allocations = heap_allocations.load(), bytes = heap_bytes.load();
+            task();
+            heap.emplace_back(heap_allocations.load() - allocations, heap_bytes.load() - bytes);
+            return [task]() {
+                task();
+                return true;
+            };
+        },
+        0, 3);
+
+    for (size_t i = 0; i < argument.values.size(); i++) {
+        const double n = static_cast<double>(ops(argument.values[i]));
+        results.add(name, argument.values[i], avgs[i] / n, static_cast<double>(heap[i].first) / n,
+                    static_cast<double>(heap[i].second) / n);
+    }
+}
+
+static void build(Table &table, size_t cells)
+{
+    table.add("PID", "User", "%CPU", "%MEM", "Command");
+    for (size_t i = 5; i < cells; i += 5) {
+        table.add(i, "root", 0.5, 11.8, "/usr/bin/tabulate --bench");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Profiler::ParseArguments(argc, argv);
+    // tables up to 1M cells can be benchmarked via argument, default is kept small for running as a test
+    size_t max_cells = 1000;
+    if (argc >= 2) {
+        max_cells = strtoul(argv[1], nullptr, 10);
+    }
+
+    Profiler::SetTitle("Benchmark of tabulate");
+    results.set_title("Heap Profile of tabulate(per operation)");
+    results.add("benchmark", "size", "time(ns)", "allocations", "bytes");
+
+    const auto cells = Profiler::Range("cells", 10, max_cells);
+    auto built = [](size_t cells) {
+        auto table = std::make_shared<Table>();
+        build(*table, cells);
+        return table;
+    };
+
+    bench(
+        "Table::add", cells,
+        [](size_t cells) {
+            return [cells]() {
+                Table table;
+                build(table, cells);
+                DoNotOptimize(table);
+            };
+        },
+        [](size_t cells) {
+            return (cells + 4) / 5;
+        });
+    bench("Column::format", cells, [&built](size_t cells) {
+        return [table = built(cells)]() {
+            table->column(3).format().align(Align::right);
+        };
+    });
+    bench("xterm", cells, [&built](size_t cells) {
+        return [table = built(cells)]() {
+            DoNotOptimize(table->xterm());
+        };
+    });
+    bench("markdown", cells, [&built](size_t cells) {
+        return [table = built(cells)]() {
+            DoNotOptimize(table->markdown());
+        };
+    });
+    bench("latex", cells, [&built](size_t cells) {
+        return [table = built(cells)]() {
+            DoNotOptimize(table->latex());
+        };
+    });
+
+    const std::string paragraph = "This paragraph contains a veryveryveryveryveryverylong word. The long word will "
+                                  "break and word wrap to the next line.";
+    const std::string multibytes = "Я тебя люблю (Ya tebya liubliu), 我爱你, 사랑해 (Saranghae)";
+    const auto ascii = Profiler::Values("bytes", {paragraph.size()});
+    const auto unicode = Profiler::Values("bytes", {multibytes.size()});
+
+    bench("wrap_lines", ascii, [&paragraph](size_t) {
+        return [&paragraph]() {
+            DoNotOptimize(wrap_lines(paragraph, 20, "", false));
+        };
+    });
+    bench("wrap_lines-multi_bytes", unicode, [&multibytes](size_t) {
+        return [&multibytes]() {
+            DoNotOptimize(wrap_lines(multibytes, 20, "", true));
+        };
+    });
+    bench("display_width_of", ascii, [&paragraph](size_t) {
+        return [&paragraph]() {
+            DoNotOptimize(display_width_of(paragraph, "", false));
+        };
+    });
+    bench("display_width_of-multi_bytes", unicode, [&multibytes](size_t) {
+        return [&multibytes]() {
+            DoNotOptimize(display_width_of(multibytes, "", true));
+        };
+    });
+
+    results.format().align(Align::right);
+    results.column(0).format().align(Align::left);
+    std::cout << results.xterm() << std::endl;
+
+    return Profiler::Finish();
+}
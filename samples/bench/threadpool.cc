@@ -0,0 +1,173 @@
+/**
+ * Copyright 2022 Kiran Nowak(kiran.nowak@gmail.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "profiler.h"
+#include "threadpool.h"
+
+/* heap profile: count allocations and bytes requested through global operator new */
+static std::atomic<size_t> heap_allocations(0);
+static std::atomic<size_t> heap_bytes(0);
+
+void *operator new(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// not inlined, otherwise GCC pairs the inlined free() with operator new and reports a mismatch
+__attribute__((noinline)) void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace tabulate;
+using namespace multiprocessing;
+
+static Table results;
+
+/**
+ * Benchmark a task performing `ops` operations, see samples/bench/tabulate.cc. Returns heap allocations per operation.
+ */
+static double bench(const std::string &name, size_t ops, std::function<void(void)> task)
+{
+    size_t allocations = heap_allocations.load(), bytes = heap_bytes.load();
+    task();
+    allocations = heap_allocations.load() - allocations;
+    bytes = heap_bytes.load() - bytes;
+
+    double avg = Profiler::Add(
+        name,
+        [&task]() {
+            task();
+            return true;
+        },
+        0, 3);
+
+    double per_op = static_cast<double>(allocations) / static_cast<double>(ops);
+    results.add(name, ops, avg / static_cast<double>(ops), per_op,
+                static_cast<double>(bytes) / static_cast<double>(ops));
+    return per_op;
+}
+
+template <int strategy>
+static std::pair<double, double> bench_strategy(const std::string &name, size_t tasks)
+{
+    threadpool<strategy> pool(std::max(std::thread::hardware_concurrency(), 2u));
+    std::atomic<size_t> executed(0);
+    std::vector<task_future<size_t>> futures;
+    futures.reserve(tasks);
+
+    double push = bench(name + "::push", tasks, [&]() {
+        for (size_t i = 0; i < tasks; i++) {
+            pool.push([&executed] {
+                executed.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        pool.wait();
+    });
+    double submit = bench(name + "::submit", tasks, [&]() {
+        futures.clear();
+        for (size_t i = 0; i < tasks; i++) {
+            futures.push_back(pool.submit([i] {
+                return i;
+            }));
+        }
+        for (auto &future : futures) {
+            DoNotOptimize(future.get());
+        }
+    });
+    return {push, submit};
+}
+
+int main(int argc, char **argv)
+{
+    Profiler::ParseArguments(argc, argv);
+    // a million tasks can be benchmarked via argument, default is kept small for running as a test
+    size_t tasks = 100000;
+    if (argc >= 2) {
+        tasks = strtoul(argv[1], nullptr, 10);
+    }
+
+    Profiler::SetTitle("Benchmark of threadpool");
+    results.set_title("Heap Profile of threadpool(per task)");
+    results.add("benchmark", "tasks", "time(ns)", "allocations", "bytes");
+
+    bench_strategy<CONDITION_VARIABLE>("condition_variable", tasks);
+    bench_strategy<YIELD_OR_SCHED_DURATION>("yield", tasks);
+    bench_strategy<WORK_STEALING>("work_stealing", tasks);
+    auto [push, submit] = bench_strategy<LOCK_FREE>("lock_free", tasks);
+
+    results.column(2).format().align(Align::right);
+    results.column(3).format().align(Align::right);
+    results.column(4).format().align(Align::right);
+    std::cout << results.xterm() << std::endl;
+
+    // producers on several threads contend on the queues of one pool
+    {
+        threadpool<WORK_STEALING> pool(std::max(std::thread::hardware_concurrency(), 2u));
+        Profiler::AddThreads(
+            "work_stealing::push",
+            [&pool]() {
+                pool.push([] {});
+                return true;
+            },
+            std::max(std::thread::hardware_concurrency(), 2u), 1000);
+        pool.wait();
+    }
+
+    // pool health of an instrumented run: where the time goes per worker, queueing vs execution
+    {
+        threadpool<WORK_STEALING> pool(std::max(std::thread::hardware_concurrency(), 2u));
+        pool.instrument();
+        pool.parallelize(
+            0, tasks,
+            [](size_t start, size_t end) {
+                for (size_t i = start; i < end; i++) {
+                    DoNotOptimize(i * i);
+                }
+            },
+            64);
+        for (size_t i = 0; i < tasks / 10; i++) {
+            pool.push([] {});
+        }
+        pool.wait();
+        Table health = pool.get_stats().to_table<Table>();
+        health.set_title("Instrumented work_stealing pool");
+        std::cout << health.xterm() << std::endl;
+    }
+
+    int status = Profiler::Finish();
+
+    // small tasks live inline in the ring, submit() allocates one block holding the task and its task_future state
+    if (push > 0.01 || submit > 1.01) {
+        std::cerr << "lock_free: " << push << " allocations per push, " << submit << " per submit" << std::endl;
+        status |= 1;
+    }
+
+    return status;
+}
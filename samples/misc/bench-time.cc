@@ -25,12 +25,14 @@
 
 int main(int argc, char **argv)
 {
+    Profiler::ParseArguments(argc, argv);
     size_t repeat = 10000;
     if (argc >= 2) {
         repeat = atoi(argv[1]);
     }
 
     Profiler::SetTitle("Benchmark of Time APIs");
+    Profiler::EnableHardwareCounters();
 
     Profiler::Add(
         "time",
@@ -109,6 +111,18 @@ int main(int argc, char **argv)
         },
         repeat);
 
+    Profiler::Add(
+        "chrono::now",
+        Profiler::TypeList<std::chrono::system_clock, std::chrono::steady_clock>(),
+        [](auto type) {
+            using Clock = typename decltype(type)::type;
+            return []() {
+                DoNotOptimize(Clock::now());
+                return true;
+            };
+        },
+        repeat);
+
     Profiler::Add(
         "HIT_FREQEUENCY",
         []() {
@@ -117,5 +131,14 @@ int main(int argc, char **argv)
         },
         repeat);
 
-    return 0;
+    // HIT_FREQEUENCY keeps its counters in statics, shared by every thread calling it
+    Profiler::AddThreads(
+        "HIT_FREQEUENCY",
+        []() {
+            DoNotOptimize(HIT_FREQEUENCY(10, 10000, 1));
+            return true;
+        },
+        std::max(std::thread::hardware_concurrency(), 2u), repeat);
+
+    return Profiler::Finish();
 }
@@ -0,0 +1,109 @@
+/**
+ * Copyright 2022 Kiran Nowak(kiran.nowak@gmail.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include "tabulate.h"
+using namespace tabulate;
+
+static Table make_table()
+{
+    Table table;
+
+    table.add("English", "I love you");
+    table.add("French", "Je t’aime");
+    table.add("Mandarin Chinese", "我爱你");
+    table.add("Japanese", "愛してる");
+    table.add("Korean", "사랑해 (Saranghae)");
+    table.add("Greek", "Σ΄αγαπώ (Se agapo)");
+    table.add("Hebrew", "אני אוהב אותך (Ani ohev otakh)");
+    table.add("Emoji", "😀 👍 ❤");
+    table.add("Combining", "été");
+
+    table.column(1).format().multi_bytes_character(true);
+    table[2][1].format().locale("zh_CN.UTF-8");
+    table.format().corner("♥").corner_color(Color::magenta).border_color(Color::magenta);
+
+    return table;
+}
+
+int main()
+{
+    // CJK is wide, combining marks are zero-width, emoji take two columns
+    if (display_width_of("我爱你", UnicodePolicy(), true) != 6
+        || display_width_of("été", UnicodePolicy(), true) != 3
+        || display_width_of("😀", UnicodePolicy(), true) != 2
+        || display_width_of("\033[1;31mred\033[0m", UnicodePolicy(), true) != 3
+        || display_width_of("Σα", UnicodePolicy(2), true) != 4) {
+        std::cerr << "unexpected display width" << std::endl;
+        return 1;
+    }
+
+    // a table policy sizes the columns, whether it is set before or after the rows are added
+    {
+        Table before, after;
+        before.unicode(UnicodePolicy(2));
+        before.add("a", "b");
+        before.add("±±±", "x");
+        after.add("a", "b");
+        after.add("±±±", "x");
+        after.unicode(UnicodePolicy(2));
+        std::cout << before.xterm() << std::endl;
+        if (before.column(0)[0].width() != 6 || before.xterm().find("±±±") == std::string::npos
+            || after.xterm() != before.xterm()) {
+            std::cerr << "table policy ignored when sizing columns" << std::endl;
+            return 1;
+        }
+    }
+
+    // a width set by the user survives a policy set afterwards
+    {
+        Table table;
+        table.add("a", "b");
+        table.add("±±±", "x");
+        table.column(1).format().width(10);
+        table.unicode(UnicodePolicy(2));
+        if (table.column(1)[0].width() != 10 || table.column(1)[1].width() != 10 || table.column(0)[1].width() != 6) {
+            std::cerr << "explicit column width lost by unicode()" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::string expected = make_table().xterm();
+    std::cout << expected << std::endl;
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&] {
+            for (int n = 0; n < 16; n++) {
+                if (make_table().xterm() != expected) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (mismatches != 0) {
+        std::cerr << mismatches << " concurrent renders differ" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
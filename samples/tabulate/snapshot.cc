@@ -0,0 +1,122 @@
+/**
+ * Copyright 2022 Kiran Nowak(kiran.nowak@gmail.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include "tabulate.h"
+using namespace tabulate;
+
+int main()
+{
+    Table movies;
+    movies.set_title("Movies");
+    movies.add("S/N", "Movie Name", "Director", "Estimated Budget", "Release Date");
+    movies.add("tt1979376", "Toy Story 4", "Josh Cooley", 200000000, "21 June 2019");
+    movies.add("tt3263904", "Sully", "Clint Eastwood", 60000000, "9 September 2016");
+    movies.add("tt1535109", "Captain Phillips", "Paul Greengrass", 55000000, " 11 October 2013");
+    movies.add("tt0000001", "(untitled)");
+
+    movies.column(2).format().align(Align::center);
+    movies.column(3).format().align(Align::right);
+    movies.column(4).format().align(Align::right);
+    for (size_t i = 0; i < movies.column_size(); ++i) {
+        movies[0][i].format().color(Color::yellow).styles(Style::bold);
+    }
+    movies[2][1].format().background_color(0x336699).corner("*");
+
+    const std::string path = "movies.snapshot";
+    if (movies.save(path) != 0) {
+        std::cerr << "failed to save snapshot" << std::endl;
+        return 1;
+    }
+
+    // zero-copy access without building a table
+    Snapshot snapshot;
+    if (snapshot.open(path) != 0) {
+        std::cerr << "failed to open snapshot" << std::endl;
+        return 1;
+    }
+    std::cout << "rows: " << snapshot.rows() << ", columns: " << snapshot.columns() << ", title: " << snapshot.title()
+              << std::endl;
+    if (snapshot.get(2, 1) != "Sully" || !snapshot.get(4, 2).empty() || snapshot.format(2, 1).corners.top_left.content != "*") {
+        std::cerr << "unexpected snapshot content" << std::endl;
+        return 1;
+    }
+    if (!snapshot.get(snapshot.rows(), 0).empty() || !snapshot.get(0, snapshot.columns()).empty()
+        || snapshot.width(snapshot.columns()) != 0) {
+        std::cerr << "out of range access should be empty" << std::endl;
+        return 1;
+    }
+
+    // a theme of the table loaded into must not leak into the restored one
+    Table restored;
+    restored.theme(themes::doubled);
+    restored.load(snapshot);
+    restored.add("tt0000002", "(appended)");
+    movies.add("tt0000002", "(appended)");
+    std::cout << restored.xterm() << std::endl;
+
+    bool same = restored.xterm() == movies.xterm() && restored.markdown() == movies.markdown()
+                && restored.latex() == movies.latex();
+    std::remove(path.c_str());
+    if (!same) {
+        std::cerr << "restored table differs from the original one" << std::endl;
+        return 1;
+    }
+
+    // opening reads cells in place, loading into a table copies each of them: time both on a larger table
+    {
+        const size_t rows = 2000;
+        Table large;
+        for (size_t r = 0; r < rows; r++) {
+            large.add(r, "root", 0.5, 11.8, "/usr/bin/tabulate --snapshot");
+        }
+        if (large.save(path) != 0) {
+            std::cerr << "failed to save snapshot" << std::endl;
+            return 1;
+        }
+
+        auto since = [](std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        auto start = std::chrono::steady_clock::now();
+        Snapshot opened;
+        size_t bytes = 0;
+        if (opened.open(path) == 0) {
+            for (size_t r = 0; r < opened.rows(); r++) {
+                for (size_t c = 0; c < opened.columns(); c++) {
+                    bytes += opened.get(r, c).size();
+                }
+            }
+        }
+        const double scan = since(start);
+
+        start = std::chrono::steady_clock::now();
+        Table loaded;
+        const int ret = loaded.load(path);
+        const double load = since(start);
+        std::remove(path.c_str());
+
+        std::cout << rows * 5 << " cells: Snapshot::open and get() " << scan << " ms, Table::load " << load << " ms"
+                  << std::endl;
+        if (bytes == 0 || ret != 0 || loaded.xterm() != large.xterm()) {
+            std::cerr << "large snapshot not restored" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * Copyright 2022 Kiran Nowak(kiran.nowak@gmail.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tabulate.h"
+using namespace tabulate;
+
+int main()
+{
+    for (auto theme : {themes::ascii, themes::unicode, themes::heavy, themes::doubled, themes::markdown}) {
+        Table table;
+        table.theme(theme);
+
+        table.add("PID", "%CPU", "%MEM", "User", "NI");
+        table.add("4297", 17.4, 2.3, "ubuntu", "20");
+        table.add("12671", 0.5, 11.8, "root", "0");
+        table.add("810", 98.1, 0.1, "root", "-20");
+
+        table.column(1).format().align(Align::right);
+        table.column(2).format().align(Align::right);
+
+        std::cout << table.xterm() << std::endl << std::endl;
+    }
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <random>
@@ -23,6 +24,10 @@
 #include <set>
 #include <map>
 #include <mutex>
+#include <numeric>
+#if defined(__linux__)
+#include <dirent.h>
+#endif
 
 class debuger {
   public:
@@ -33,9 +38,7 @@ class debuger {
     {
         const std::scoped_lock __(lock);
         os << first;
-        if (sizeof...(Args) > 0) {
-            print(" ", args...);
-        }
+        ((os << " " << args), ...);
     }
 
     template <typename... T>
@@ -350,6 +353,16 @@ void check_push_task()
         pool.wait();
         check(flag1 && flag2);
     }
+    dual_println("Checking that push() works for a move-only function...");
+    {
+        bool flag = false;
+        std::unique_ptr<bool *> owned(new bool *(&flag));
+        pool.push([owned = std::move(owned)] {
+            **owned = true;
+        });
+        pool.wait();
+        check(flag);
+    }
 }
 
 /**
@@ -625,6 +638,1118 @@ void check_exceptions()
     check(caught);
 }
 
+/**
+ * @brief Check that the work stealing strategy runs external, nested and recursive tasks.
+ */
+void check_work_stealing()
+{
+    threadpool<WORK_STEALING> stealing(std::thread::hardware_concurrency());
+
+    dual_println("Checking that tasks pushed from outside the pool are all executed...");
+    {
+        std::atomic<ui32> counter = 0;
+        for (ui32 i = 0; i < 10000; i++) {
+            stealing.push([&counter] {
+                counter++;
+            });
+        }
+        stealing.wait();
+        check(counter == 10000);
+    }
+    dual_println("Checking that tasks recursively pushed from workers are all executed...");
+    {
+        std::atomic<ui32> counter = 0;
+        std::function<void(ui32)> spawn = [&](ui32 depth) {
+            counter++;
+            if (depth > 0) {
+                stealing.push(spawn, depth - 1);
+                stealing.push(spawn, depth - 1);
+            }
+        };
+        stealing.push(spawn, 12);
+        stealing.wait();
+        check(counter == (1u << 13) - 1);
+    }
+    dual_println("Checking that parallelize() can be nested inside a task...");
+    {
+        std::atomic<i64> sum = 0;
+        stealing.push([&] {
+            stealing.parallelize(
+                0, 1000,
+                [&sum](const i32 &start, const i32 &end) {
+                    for (i32 i = start; i < end; i++) sum += i;
+                },
+                100);
+        });
+        stealing.wait();
+        check(sum == 999 * 1000 / 2);
+    }
+    dual_println("Checking that submit() works from inside a task...");
+    {
+        task_future<int> inner;
+        auto outer = stealing.submit([&] {
+            inner = stealing.submit([] {
+                return 42;
+            });
+        });
+        check(outer.get() && inner.get() == 42);
+    }
+    dual_println("Checking that the pool keeps working after reset()...");
+    {
+        stealing.reset(std::thread::hardware_concurrency() + 1);
+        std::atomic<ui32> counter = 0;
+        for (ui32 i = 0; i < 1000; i++) {
+            stealing.push([&counter] {
+                counter++;
+            });
+        }
+        stealing.wait();
+        check(counter == 1000 && stealing.get_task_size_queued() == 0);
+    }
+}
+
+/**
+ * @brief Check that the lock free queue and strategy work, including when the queue is full.
+ */
+void check_lock_free()
+{
+    dual_println("Checking that the MPMC queue delivers every item exactly once with 4 producers and 4 consumers...");
+    {
+        mpmc_queue<ui64> queue(64);
+        std::atomic<ui64> sum = 0, popped = 0;
+        std::vector<std::thread> threads;
+        for (ui32 p = 0; p < 4; p++) {
+            threads.emplace_back([&queue] {
+                for (ui64 i = 1; i <= 10000; i++) {
+                    ui64 item = i;
+                    while (!queue.try_push(std::move(item))) std::this_thread::yield();
+                }
+            });
+        }
+        for (ui32 c = 0; c < 4; c++) {
+            threads.emplace_back([&] {
+                ui64 item;
+                while (popped < 40000) {
+                    if (queue.try_pop(item)) {
+                        sum += item;
+                        popped++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        check(sum == 4 * (10000 * 10001 / 2) && queue.empty());
+    }
+
+    threadpool<LOCK_FREE> lockfree(std::thread::hardware_concurrency(), 16);
+    dual_println("Checking that tasks are all executed when the queue is smaller than the number of tasks...");
+    {
+        std::atomic<ui32> counter = 0;
+        for (ui32 i = 0; i < 10000; i++) {
+            lockfree.push([&counter] {
+                counter++;
+            });
+        }
+        lockfree.wait();
+        check(counter == 10000);
+    }
+    dual_println("Checking that a producer outside the pool waits on a full queue instead of running tasks itself...");
+    {
+        std::atomic<ui32> counter = 0, inline_runs = 0;
+        const std::thread::id producer = std::this_thread::get_id();
+        for (ui32 i = 0; i < 1000; i++) {
+            lockfree.push([&counter, &inline_runs, producer] {
+                if (std::this_thread::get_id() == producer) {
+                    inline_runs++;
+                }
+                counter++;
+            });
+        }
+        lockfree.wait();
+        check(counter == 1000 && inline_runs == 0);
+
+        counter = 0;
+        lockfree.pause();
+        std::thread flood([&] {
+            for (ui32 i = 0; i < 64; i++) {
+                lockfree.push([&counter] {
+                    counter++;
+                });
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        bool held = counter == 0;
+        lockfree.resume();
+        flood.join();
+        lockfree.wait();
+        check(held && counter == 64);
+    }
+    dual_println("Checking that tasks recursively pushed from workers are all executed...");
+    {
+        std::atomic<ui32> counter = 0;
+        std::function<void(ui32)> spawn = [&](ui32 depth) {
+            counter++;
+            if (depth > 0) {
+                lockfree.push(spawn, depth - 1);
+                lockfree.push(spawn, depth - 1);
+            }
+        };
+        lockfree.push(spawn, 12);
+        lockfree.wait();
+        check(counter == (1u << 13) - 1);
+    }
+    dual_println("Checking that submit() and parallelize() work...");
+    {
+        std::atomic<i64> sum = 0;
+        lockfree.parallelize(
+            0, 1000,
+            [&sum](const i32 &start, const i32 &end) {
+                for (i32 i = start; i < end; i++) sum += i;
+            },
+            100);
+        auto future = lockfree.submit([] {
+            return 42;
+        });
+        check(sum == 999 * 1000 / 2 && future.get() == 42);
+    }
+    dual_println("Checking that parked workers pick up tasks after pause() and resume()...");
+    {
+        std::atomic<ui32> counter = 0;
+        lockfree.pause();
+        for (ui32 i = 0; i < 10; i++) {
+            lockfree.push([&counter] {
+                counter++;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const ui32 while_paused = counter;
+        lockfree.resume();
+        lockfree.wait();
+        check(while_paused == 0 && counter == 10);
+    }
+}
+
+/**
+ * @brief Check push_batch() and submit_range() on a pool with the given strategy.
+ *
+ * @param name The name of the strategy.
+ * @param executor The pool to use.
+ */
+template <int strategy>
+void check_batch(const std::string &name, threadpool<strategy> &executor)
+{
+    dual_println("Checking that push_batch() runs every task of the batch (", name, ")...");
+    {
+        std::atomic<ui32> counter = 0;
+        std::vector<std::function<void()>> tasks(1000, [&counter] {
+            counter++;
+        });
+        batch_future batch = executor.push_batch(tasks.begin(), tasks.end());
+        batch.get();
+        check(counter == 1000 && batch.size() == 1000 && !batch.valid());
+    }
+    dual_println("Checking that submit_range() runs every index exactly once (", name, ")...");
+    {
+        std::vector<std::atomic<ui32>> hits(10000);
+        batch_future batch = executor.submit_range(
+            0, 10000,
+            [&hits](const ui32 &start, const ui32 &end) {
+                for (ui32 i = start; i < end; i++) hits[i]++;
+            },
+            64);
+        batch.wait();
+        bool once = true;
+        for (auto &hit : hits) once = once && hit == 1;
+        check(once && batch.is_ready() && batch.size() == 64);
+    }
+    dual_println("Checking that get() rethrows an exception of the batch (", name, ")...");
+    {
+        batch_future batch = executor.submit_range(
+            0, 100,
+            [](const i32 &start, const i32 &) {
+                if (start == 50) throw std::runtime_error("Exception thrown!");
+            },
+            10);
+        bool caught = false;
+        try {
+            batch.get();
+        } catch (const std::exception &e) {
+            caught = e.what() == std::string("Exception thrown!");
+        }
+        check(caught && executor.submit_range(5, 5, [](i32, i32) {}).is_ready());
+    }
+    dual_println("Checking that wait_for() times out on a running batch and wakes up when it is done (", name, ")...");
+    {
+        std::atomic<bool> release = false;
+        auto blocked = [&release] {
+            while (!release) std::this_thread::yield();
+        };
+        auto task = executor.submit(blocked);
+        batch_future batch = executor.submit_range(
+            0, 1,
+            [&blocked](i32, i32) {
+                blocked();
+            },
+            1);
+        const bool timed_out = task.wait_for(std::chrono::milliseconds(10)) == std::future_status::timeout
+                               && batch.wait_for(std::chrono::milliseconds(10)) == std::future_status::timeout;
+        release = true;
+        check(timed_out && task.wait_for(std::chrono::seconds(10)) == std::future_status::ready
+              && batch.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    }
+#if defined(__linux__)
+    dual_println("Checking that wait_for() sleeps rather than polls (", name, ")...");
+    {
+        auto task = executor.submit([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+        timespec before, after;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &before);
+        const bool ready = task.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+        const bool timed_out = executor.submit_range(0, 1, [](i32, i32) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }).wait_for(std::chrono::milliseconds(200)) == std::future_status::timeout;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &after);
+        const double cpu = (after.tv_sec - before.tv_sec) + (after.tv_nsec - before.tv_nsec) / 1e9;
+        dual_println("CPU time of the waiting thread ", cpu, "s over 0.4s.");
+        check(ready && timed_out && cpu < 0.002);
+    }
+#endif
+}
+
+/**
+ * @brief Check batches with every strategy, the lock free ring being smaller than the batches.
+ */
+void check_batches()
+{
+    check_batch("yield", pool);
+    threadpool<CONDITION_VARIABLE> cv;
+    check_batch("condition variable", cv);
+    threadpool<WORK_STEALING> stealing;
+    check_batch("work stealing", stealing);
+    threadpool<LOCK_FREE> lockfree(std::thread::hardware_concurrency(), 16);
+    check_batch("lock free", lockfree);
+}
+
+/**
+ * @brief Check that every schedule covers a range exactly once.
+ *
+ * @param name The name of the strategy.
+ * @param executor The pool to use.
+ */
+template <int strategy>
+void check_schedule(const std::string &name, threadpool<strategy> &executor)
+{
+    const std::pair<std::string, schedule> schedules[] = {
+        {"static", schedule::blocks(7)}, {"dynamic", schedule::dynamic()}, {"dynamic, chunk 64", schedule::dynamic(64)},
+        {"guided", schedule::guided()},  {"guided, chunk 16", schedule::guided(16)},
+    };
+    for (const auto &[label, policy] : schedules) {
+        dual_println("Checking that a ", label, " schedule runs every index exactly once (", name, ")...");
+        std::vector<std::atomic<ui32>> hits(10007);
+        executor.parallelize(
+            -5000, 5007,
+            [&hits](const i32 &start, const i32 &end) {
+                for (i32 i = start; i < end; i++) hits[i + 5000]++;
+            },
+            policy);
+        bool once = true;
+        for (auto &hit : hits) once = once && hit == 1;
+        std::atomic<ui32> small = 0;
+        executor.parallelize(
+            3, 0,
+            [&small](const ui32 &start, const ui32 &end) {
+                small += end - start;
+            },
+            policy);
+        check(once && small == 3);
+    }
+}
+
+/**
+ * @brief Check the schedules with every strategy.
+ */
+void check_schedules()
+{
+    check_schedule("yield", pool);
+    threadpool<CONDITION_VARIABLE> cv;
+    check_schedule("condition variable", cv);
+    threadpool<WORK_STEALING> stealing;
+    check_schedule("work stealing", stealing);
+    threadpool<LOCK_FREE> lockfree;
+    check_schedule("lock free", lockfree);
+}
+
+/**
+ * @brief Check the parallel algorithms against their std counterparts.
+ *
+ * @param name The name of the strategy.
+ * @param executor The pool to use.
+ */
+template <int strategy>
+void check_algorithm(const std::string &name, threadpool<strategy> &executor)
+{
+    std::mt19937_64 mt(42);
+    std::uniform_int_distribution<i32> dist(-1000, 1000);
+    for (size_t size : {0, 1, 7, 100003}) {
+        std::vector<i32> input(size);
+        for (auto &value : input) value = dist(mt);
+        dual_println("Checking the parallel algorithms on ", size, " elements (", name, ")...");
+
+        std::vector<i32> expected = input, actual = input;
+        std::for_each(expected.begin(), expected.end(), [](i32 &value) {
+            value += 3;
+        });
+        algorithms::for_each(executor, actual.begin(), actual.end(), [](i32 &value) {
+            value += 3;
+        });
+        bool same = expected == actual;
+        algorithms::for_each(
+            executor, actual.begin(), actual.end(),
+            [](i32 &value) {
+                value -= 3;
+            },
+            schedule::dynamic(100));
+        same = same && actual == input;
+
+        auto square = [](const i32 &value) {
+            return (i64)value * value;
+        };
+        std::vector<i64> squares(size), parallel_squares(size);
+        std::transform(input.begin(), input.end(), squares.begin(), square);
+        auto end = algorithms::transform(executor, input.begin(), input.end(), parallel_squares.begin(), square);
+        same = same && squares == parallel_squares && end == parallel_squares.end();
+
+        same = same && std::accumulate(input.begin(), input.end(), (i64)5)
+                           == algorithms::reduce(executor, input.begin(), input.end(), (i64)5);
+        same = same
+               && std::transform_reduce(input.begin(), input.end(), (i64)0, std::plus<>(), square)
+                      == algorithms::transform_reduce(executor, input.begin(), input.end(), (i64)0, std::plus<>(),
+                                                      square);
+
+        std::vector<i64> sums(size), parallel_sums(squares);
+        std::inclusive_scan(squares.begin(), squares.end(), sums.begin());
+        algorithms::inclusive_scan(executor, parallel_sums.begin(), parallel_sums.end(), parallel_sums.begin());
+        same = same && sums == parallel_sums;
+
+        expected = input;
+        actual = input;
+        std::sort(expected.begin(), expected.end());
+        algorithms::sort(executor, actual.begin(), actual.end());
+        same = same && expected == actual;
+        std::sort(expected.begin(), expected.end(), std::greater<>());
+        algorithms::sort(executor, actual.begin(), actual.end(), std::greater<>());
+        check(same && expected == actual);
+    }
+}
+
+/**
+ * @brief Check the parallel algorithms with two strategies.
+ */
+void check_algorithms()
+{
+    check_algorithm("yield", pool);
+    threadpool<WORK_STEALING> stealing(5);
+    check_algorithm("work stealing", stealing);
+}
+
+/**
+ * @brief Check that a task graph runs its nodes after their predecessors, can be run again, and reports errors.
+ *
+ * @param name The name of the strategy.
+ * @param executor The pool to use.
+ */
+template <int strategy>
+void check_task_graph(const std::string &name, threadpool<strategy> &executor)
+{
+    dual_println("Checking that a task graph respects its dependencies over repeated runs (", name, ")...");
+    {
+        // collect -> compute -> build -> three exports, all exports -> done
+        std::atomic<ui32> clock = 0;
+        std::vector<std::atomic<ui32>> stamps(7);
+        task_graph graph;
+        auto stamp = [&](size_t i) {
+            return [&, i] {
+                stamps[i] = ++clock;
+            };
+        };
+        auto collect = graph.emplace(stamp(0));
+        auto compute = graph.emplace(stamp(1), {collect});
+        auto build = graph.emplace(stamp(2), {compute});
+        auto text = graph.emplace(stamp(3), {build});
+        auto csv = graph.emplace(stamp(4), {build});
+        auto json = graph.emplace(stamp(5), {build});
+        graph.emplace(stamp(6), {text, csv, json});
+        bool ordered = true;
+        for (ui32 run = 0; run < 100; run++) {
+            clock = 0;
+            batch_future done = graph.run(executor);
+            executor.wait(done);
+            done.get();
+            ordered = ordered && clock == 7 && stamps[0] == 1 && stamps[1] == 2 && stamps[2] == 3;
+            for (size_t i = 3; i < 6; i++) ordered = ordered && stamps[i] > 3 && stamps[i] < stamps[6];
+        }
+        check(ordered && graph.size() == 7);
+    }
+    dual_println("Checking that a throwing node skips its successors and that cycles are rejected (", name, ")...");
+    {
+        std::atomic<ui32> skipped = 0;
+        task_graph graph;
+        auto fail = graph.emplace([] {
+            throw std::runtime_error("Exception thrown!");
+        });
+        graph.emplace(
+            [&skipped] {
+                skipped++;
+            },
+            {fail});
+        batch_future done = graph.run(executor);
+        bool caught = false;
+        try {
+            executor.wait(done);
+            done.get();
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        task_graph cycle;
+        auto first = cycle.emplace([] {});
+        cycle.precede(cycle.emplace([] {}, {first}), first);
+        bool rejected = false;
+        try {
+            cycle.run(executor);
+        } catch (const std::logic_error &) {
+            rejected = true;
+        }
+        check(caught && skipped == 0 && rejected && task_graph().run(executor).is_ready());
+    }
+}
+
+/**
+ * @brief Check task graphs with every strategy.
+ */
+void check_task_graphs()
+{
+    check_task_graph("yield", pool);
+    threadpool<CONDITION_VARIABLE> cv;
+    check_task_graph("condition variable", cv);
+    threadpool<WORK_STEALING> stealing;
+    check_task_graph("work stealing", stealing);
+    threadpool<LOCK_FREE> lockfree(std::thread::hardware_concurrency(), 16);
+    check_task_graph("lock free", lockfree);
+}
+
+/**
+ * @brief Check that prioritized tasks run by deadline, lane and age, on a single worker held up by a gate task.
+ *
+ * @param name The name of the strategy.
+ */
+template <int strategy>
+void check_priority(const std::string &name)
+{
+    threadpool<strategy> executor(1);
+    std::atomic<bool> gate = false;
+    std::mutex lock;
+    std::vector<i32> order;
+    auto hold = [&] {
+        gate = false;
+        order.clear();
+        executor.push([&gate] {
+            while (!gate) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    };
+    auto record = [&](i32 id) {
+        return [&lock, &order, id] {
+            const std::scoped_lock guard(lock);
+            order.push_back(id);
+        };
+    };
+
+    dual_println("Checking that HIGH tasks overtake LOW tasks and deadlines come first (", name, ")...");
+    hold();
+    for (i32 i = 0; i < 10; i++) executor.push_prioritized(priority::LOW, record(100 + i));
+    for (i32 i = 0; i < 3; i++) executor.push_prioritized(priority::HIGH, record(10 + i));
+    const auto now = std::chrono::steady_clock::now();
+    for (i32 i = 0; i < 3; i++)
+        executor.push_prioritized(priority::before(now - std::chrono::seconds(3 - i)), record(i));
+    gate = true;
+    executor.wait();
+    std::vector<i32> expected = {0, 1, 2, 10, 11, 12};
+    for (i32 i = 0; i < 10; i++) expected.push_back(100 + i);
+    check(order == expected);
+
+    dual_println("Checking that LOW tasks age ahead of newer HIGH tasks (", name, ")...");
+    hold();
+    executor.set_lane_budget(priority::LOW, std::chrono::milliseconds(1));
+    executor.push_prioritized(priority::LOW, record(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    executor.push_prioritized(priority::HIGH, record(2));
+    gate = true;
+    executor.wait();
+    check(order == std::vector<i32>{1, 2});
+
+    dual_println("Checking the lane metrics (", name, ")...");
+    lane_metrics high = executor.get_lane_metrics(priority::HIGH), low = executor.get_lane_metrics(priority::LOW),
+                 normal = executor.get_lane_metrics(priority::NORMAL);
+    check(high.executed == 4 && low.executed == 11 && normal.executed == 3 && normal.missed == 3 && low.queued == 0
+          && low.max_latency >= std::chrono::milliseconds(5) && high.mean_latency <= high.max_latency);
+}
+
+/**
+ * @brief Check priorities with every strategy.
+ */
+void check_priorities()
+{
+    check_priority<YIELD_OR_SCHED_DURATION>("yield");
+    check_priority<CONDITION_VARIABLE>("condition variable");
+    check_priority<WORK_STEALING>("work stealing");
+    check_priority<LOCK_FREE>("lock free");
+}
+
+/**
+ * @brief Check the topology parsing, worker placement on a simulated two node topology, and pinning.
+ */
+void check_placement()
+{
+    dual_println("Checking that cpu lists and topologies are read correctly...");
+    const cpu_topology detected = cpu_topology::detect(), fallback = cpu_topology::detect("/nonexistent");
+    dual_println("Detected ", detected.nodes.size(), " node(s) with ", detected.cpu_count(), " cpu(s).");
+    check(cpu_topology::parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}
+          && !detected.nodes.empty() && detected.cpu_count() > 0 && fallback.nodes.size() == 1
+          && fallback.cpu_count() == std::max(1u, std::thread::hardware_concurrency()));
+
+    dual_println("Checking that workers are spread over a simulated topology and that tasks cross nodes...");
+    {
+        threadpool<WORK_STEALING> executor(6);
+        bool placed = executor.place(cpu_topology::simulated(2, 2), false);
+        std::vector<ui32> nodes;
+        for (ui32 i = 0; i < 6; i++) nodes.push_back(executor.get_worker_node(i));
+        std::atomic<ui32> counter = 0;
+        for (ui32 round = 0; round < 20; round++) {
+            executor.push([&] {
+                for (ui32 i = 0; i < 100; i++)
+                    executor.push([&counter] {
+                        counter++;
+                    });
+            });
+            for (ui32 i = 0; i < 100; i++)
+                executor.push([&counter] {
+                    counter++;
+                });
+            executor.wait();
+        }
+        executor.reset(3);
+        executor.parallelize(0, 1000, [&counter](const ui32 &start, const ui32 &end) {
+            counter += end - start;
+        });
+        check(placed && nodes == std::vector<ui32>{0, 0, 1, 1, 0, 0} && counter == 5000
+              && executor.get_worker_node(2) == 1);
+    }
+
+    dual_println("Checking that a topology without cpus is rejected and that placing while tasks run loses none...");
+    {
+        threadpool<WORK_STEALING> executor(4);
+        cpu_topology empty, no_cpus;
+        no_cpus.nodes.emplace_back();
+        const bool rejected = !executor.place(empty) && !executor.place(no_cpus);
+        std::atomic<ui32> counter = 0;
+        for (ui32 round = 0; round < 50; round++) {
+            for (ui32 i = 0; i < 100; i++)
+                executor.push([&counter] {
+                    counter++;
+                });
+            executor.place(cpu_topology::simulated(1 + round % 3, 2), false);
+        }
+        executor.wait();
+        check(rejected && counter == 5000);
+    }
+
+#if defined(__linux__)
+    dual_println("Checking that pinned workers run on their cpu...");
+    {
+        threadpool<CONDITION_VARIABLE> executor(3);
+        const int cpu = detected.nodes[0][0];
+        bool pinned = executor.pin({cpu});
+        std::atomic<ui32> elsewhere = 0;
+        for (ui32 i = 0; i < 100; i++)
+            executor.push([&elsewhere, cpu] {
+                if (sched_getcpu() != cpu) elsewhere++;
+            });
+        executor.wait();
+        check(pinned && elsewhere == 0 && !executor.pin({1 << 20}));
+    }
+#endif
+}
+
+/**
+ * @brief Collects the rows of threadpool_stats::to_table(), standing in for tabulate::Table.
+ */
+struct row_collector {
+    std::vector<std::vector<std::string>> rows;
+
+    template <typename... T>
+    void add(const T &...cells)
+    {
+        rows.push_back({cells...});
+    }
+};
+
+/**
+ * @brief Check the histograms and the per-worker counters of an instrumented pool.
+ *
+ * @param name The name of the strategy.
+ */
+template <int strategy>
+void check_instrument(const std::string &name)
+{
+    dual_println("Checking that an instrumented pool counts and times every task (", name, ")...");
+    threadpool<strategy> executor(3);
+    executor.instrument();
+    for (ui32 i = 0; i < 60; i++)
+        executor.push([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    executor.wait();
+    executor.parallelize(0, 30, [](const ui32 &, const ui32 &) {}, 30);
+    executor.instrument(false);
+    executor.push([] {});
+    executor.wait();
+
+    const threadpool_stats stats = executor.get_stats();
+    uint64_t executed = 0;
+    for (const auto &w : stats.workers) executed += w.executed;
+    const log_histogram latency = stats.latency(), runtime = stats.runtime();
+    const row_collector table = stats.to_table<row_collector>();
+    dual_println("Run time p50 ", threadpool_stats::format_ns((double)runtime.percentile(50)), ", wait p99 ",
+                 threadpool_stats::format_ns((double)latency.percentile(99)), ".");
+    check(stats.workers.size() == 4 && executed == 90 && latency.total == 90 && runtime.total == 90
+          && runtime.max >= 1000000 && runtime.percentile(90) >= 900000 && stats.unfinished == 0
+          && table.rows.size() == 6 && table.rows[5][0] == "total" && table.rows[5][1] == "90");
+}
+
+/**
+ * @brief Check the histogram buckets and the instrumentation with every strategy.
+ */
+void check_instrumentation()
+{
+    dual_println("Checking that histogram buckets bracket their values and percentiles are close...");
+    bool bracketed = true;
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        const size_t index = log_histogram::index_of(value);
+        bracketed = bracketed && index < log_histogram::bucket_count && log_histogram::lowest_of(index) <= value
+                    && (index + 1 == log_histogram::bucket_count || log_histogram::lowest_of(index + 1) > value);
+    }
+    log_histogram histogram;
+    for (ui32 i = 1; i <= 1000; i++) histogram.record(i * 1000);
+    const double p50 = (double)histogram.percentile(50), p99 = (double)histogram.percentile(99);
+    check(bracketed && std::abs(p50 - 500000) < 0.07 * 500000 && std::abs(p99 - 990000) < 0.07 * 990000
+          && histogram.max == 1000000 && histogram.mean() == 500500);
+
+    check_instrument<YIELD_OR_SCHED_DURATION>("yield");
+    check_instrument<CONDITION_VARIABLE>("condition variable");
+    check_instrument<WORK_STEALING>("work stealing");
+    check_instrument<LOCK_FREE>("lock free");
+}
+
+/**
+ * @brief Check that an elastic pool grows under long tasks, shrinks back when idle and finishes all of its tasks.
+ */
+template <int strategy>
+void check_elastic(const std::string &name)
+{
+    dual_println("Checking that an elastic pool grows and shrinks with the load (", name, ")...");
+    threadpool<strategy> executor(2);
+    executor.elastic(1, 4, std::chrono::milliseconds(1), std::chrono::milliseconds(50));
+    const ui32 initial = (ui32)executor.get_worker_size();
+    std::atomic<ui32> completed = 0;
+    ui32 peak = 0;
+    for (ui32 i = 0; i < 8; i++)
+        executor.push([&completed] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            completed++;
+        });
+    while (completed < 8) {
+        peak = std::max<ui32>(peak, executor.get_worker_size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    executor.wait();
+    for (ui32 i = 0; i < 200 && executor.get_worker_size() > 1; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const ui32 shrunk = (ui32)executor.get_worker_size();
+    for (ui32 i = 0; i < 8; i++)
+        executor.push([&completed] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            completed++;
+        });
+    executor.wait();
+    dual_println("Started with ", initial, " worker(s), peaked at ", peak, ", shrank to ", shrunk, ".");
+    executor.reset(3);
+    check(initial == 1 && peak > 1 && peak <= 4 && shrunk == 1 && completed == 16 && executor.get_worker_size() == 3);
+}
+
+#if defined(__linux__)
+/**
+ * @brief Time on cpu of every thread of the process, in nanoseconds by thread id.
+ */
+std::map<std::string, uint64_t> thread_cpu_times()
+{
+    std::map<std::string, uint64_t> times;
+    if (DIR *dir = opendir("/proc/self/task")) {
+        while (dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            uint64_t ns = 0;
+            std::ifstream(std::string("/proc/self/task/") + entry->d_name + "/schedstat") >> ns;
+            times[entry->d_name] = ns;
+        }
+        closedir(dir);
+    }
+    return times;
+}
+
+/**
+ * @brief Check that the idle workers of an elastic pool sleep until their idle timeout instead of polling. Only the
+ * threads of the new pool are measured, the global pool polls by design.
+ *
+ * @param name The name of the strategy.
+ */
+template <int strategy>
+void check_elastic_idle(const std::string &name)
+{
+    dual_println("Checking that idle workers of an elastic pool do not burn a core (", name, ")...");
+    const std::map<std::string, uint64_t> others = thread_cpu_times();
+    threadpool<strategy> executor(4);
+    executor.elastic(4, 8, std::chrono::milliseconds(1), std::chrono::seconds(10));
+    executor.push([] {});
+    executor.wait();
+    const std::map<std::string, uint64_t> start = thread_cpu_times();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double cpu = 0;
+    for (auto &[thread, ns] : thread_cpu_times()) {
+        if (others.count(thread) == 0 && start.count(thread) != 0) cpu += (ns - start.at(thread)) / 1e9;
+    }
+    dual_println("CPU time of the workers ", cpu, "s over 0.5s.");
+    check(cpu < 0.01);
+}
+#endif
+
+/**
+ * @brief Check elastic pools with every strategy.
+ */
+void check_elastics()
+{
+    check_elastic<YIELD_OR_SCHED_DURATION>("yield");
+    check_elastic<CONDITION_VARIABLE>("condition variable");
+    check_elastic<WORK_STEALING>("work stealing");
+    check_elastic<LOCK_FREE>("lock free");
+#if defined(__linux__)
+    check_elastic_idle<CONDITION_VARIABLE>("condition variable");
+    check_elastic_idle<WORK_STEALING>("work stealing");
+    check_elastic_idle<LOCK_FREE>("lock free");
+#endif
+}
+
+/**
+ * @brief Check that delayed and periodic tasks run on time, on the workers, and stop when cancelled.
+ */
+template <int strategy>
+void check_timer(const std::string &name)
+{
+    dual_println("Checking that delayed and periodic tasks run on time on the workers (", name, ")...");
+    threadpool<strategy> executor(2);
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<int64_t> delayed_after = 0;
+    std::atomic<ui32> ticks = 0, cancelled_runs = 0, collected = 0;
+    std::mutex ids_lock;
+    std::set<std::thread::id> ids;
+    executor.schedule_after(std::chrono::milliseconds(30), [&delayed_after, start] {
+        delayed_after = (std::chrono::steady_clock::now() - start).count();
+    });
+    timer_handle every = executor.schedule_every(std::chrono::milliseconds(10), [&ticks] {
+        ticks++;
+    });
+    executor.schedule_after(std::chrono::milliseconds(20), [&cancelled_runs] {
+        cancelled_runs++;
+    }).cancel();
+    std::vector<timer_handle> collectors;
+    for (ui32 i = 0; i < 2000; i++)
+        collectors.push_back(executor.schedule_every(std::chrono::milliseconds(5 + i % 20), [&] {
+            collected++;
+            std::lock_guard<std::mutex> guard(ids_lock);
+            ids.insert(std::this_thread::get_id());
+        }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(205));
+    every.cancel();
+    for (auto &collector : collectors) collector.cancel();
+    const ui32 ticked = ticks;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    executor.wait();
+    dual_println("Delayed task ran after ", delayed_after / 1000000.0, "ms, periodic task ran ", ticked,
+                 " times in 205ms, collectors ran ", collected.load(), " times on ", ids.size(), " thread(s).");
+    check(delayed_after >= 30000000 && ticked >= 10 && ticked <= 21 && ticks == every.fired() && ticks <= ticked + 1
+          && cancelled_runs == 0 && collected > 2000 && ids.size() <= 2 && executor.get_timer_size() == 0);
+}
+
+/**
+ * @brief Check the timing wheel and the timers with every strategy.
+ */
+void check_timers()
+{
+    dual_println("Checking that the timing wheel expires entries at their tick, across levels...");
+    timing_wheel<uint64_t> wheel(1000);
+    std::vector<uint64_t> expiries = {1001, 1063, 1064, 1065, 5095, 5096, 263144, 16778216, 33554432, 40000000};
+    for (uint64_t expiry : expiries) wheel.insert(expiry, expiry);
+    bool exact = true;
+    std::vector<uint64_t> expired;
+    for (uint64_t expiry : expiries) {
+        wheel.advance(expiry - 1, [&exact](uint64_t &&) {
+            exact = false;
+        });
+        wheel.advance(expiry, [&expired](uint64_t &&e) {
+            expired.push_back(e);
+        });
+    }
+    check(exact && expired == expiries && wheel.size() == 0);
+
+    check_timer<YIELD_OR_SCHED_DURATION>("yield");
+    check_timer<CONDITION_VARIABLE>("condition variable");
+    check_timer<WORK_STEALING>("work stealing");
+    check_timer<LOCK_FREE>("lock free");
+}
+
+/**
+ * @brief Check that cancelled tasks never run and are compacted away, and that running tasks see their stop_token.
+ */
+template <int strategy>
+void check_cancel(const std::string &name)
+{
+    dual_println("Checking that cancelled tasks are skipped and running tasks can stop (", name, ")...");
+    threadpool<strategy> executor(2);
+    std::atomic<bool> stopped = false;
+    auto running = executor.submit([&stopped](stop_token token) {
+        while (!token.stop_requested()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stopped = true;
+        return (ui32)7;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const bool stopped_before_start = running.cancel();
+    const bool stop_seen = running.get() == 7 && stopped;
+
+    std::atomic<bool> release = false;
+    for (ui32 i = 0; i < 2; i++)
+        executor.push([&release] {
+            while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // both workers busy
+    std::atomic<ui32> ran = 0;
+    auto payload = std::make_shared<std::vector<ui32>>(1000);
+    const std::weak_ptr<std::vector<ui32>> payload_alive = payload;
+    std::vector<task_future<ui32>> futures;
+    for (ui32 i = 0; i < 2000; i++)
+        futures.push_back(executor.submit([&ran, payload, i] {
+            ran++;
+            return i;
+        }));
+    payload.reset();
+    ui32 cancelled = 0;
+    for (ui32 i = 0; i < 2000; i++) cancelled += i % 10 != 0 && futures[i].cancel();
+    const bool ready_at_once = !payload_alive.expired() && futures[1].is_ready();
+    for (ui32 i = 0; i < 1500; i++) executor.push([] {});
+    const size_t queued = executor.get_task_size_queued();
+    release = true;
+
+    ui32 results = 0, thrown = 0;
+    for (ui32 i = 0; i < 2000; i++) {
+        try {
+            results += futures[i].get() == i;
+        } catch (const task_cancelled &) {
+            thrown++;
+        }
+    }
+    executor.wait();
+    dual_println("Cancelled ", cancelled, " queued tasks, ", queued, " tasks left queued after compaction.");
+    check(!stopped_before_start && stop_seen && cancelled == 1800 && ready_at_once && results == 200 && thrown == 1800
+          && ran == 200 && payload_alive.expired() && (strategy == LOCK_FREE || queued == 1700));
+}
+
+/**
+ * @brief Check cancellation with every strategy.
+ */
+void check_cancels()
+{
+    check_cancel<YIELD_OR_SCHED_DURATION>("yield");
+    check_cancel<CONDITION_VARIABLE>("condition variable");
+    check_cancel<WORK_STEALING>("work stealing");
+    check_cancel<LOCK_FREE>("lock free");
+}
+
+#if defined(THREADPOOL_COROUTINES)
+template <int strategy>
+task<ui32> square_on(threadpool<strategy> &executor, ui32 value)
+{
+    co_await executor.schedule();
+    co_return value * value;
+}
+
+template <int strategy>
+task<ui32> sum_of_squares(threadpool<strategy> &executor, ui32 count)
+{
+    std::vector<task<ui32>> squares;
+    for (ui32 i = 0; i < count; i++) squares.push_back(square_on(executor, i));
+    std::vector<ui32> values = co_await when_all(std::move(squares));
+    co_return std::accumulate(values.begin(), values.end(), 0u);
+}
+
+template <int strategy>
+task<void> probe_on(threadpool<strategy> &executor, std::thread::id caller, std::atomic<ui32> &hopped)
+{
+    co_await executor.schedule();
+    if (std::this_thread::get_id() != caller) hopped++;
+}
+
+template <int strategy>
+task<ui32> sleep_on(threadpool<strategy> &executor, ui32 ms)
+{
+    co_await executor.schedule();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    co_return ms;
+}
+
+template <int strategy>
+task<ui32> throw_on(threadpool<strategy> &executor)
+{
+    co_await executor.schedule();
+    throw std::runtime_error("Exception thrown!");
+}
+
+template <int strategy>
+task<ui32> await_submit(threadpool<strategy> &executor)
+{
+    ui32 value = co_await executor.submit([] {
+        return 40u;
+    });
+    co_return value + 2;
+}
+
+/**
+ * @brief Check that coroutines hop onto the pool, and that when_all(), when_any() and awaited futures work.
+ */
+template <int strategy>
+void check_coroutine(const std::string &name)
+{
+    dual_println("Checking that coroutines run on the pool and combine (", name, ")...");
+    threadpool<strategy> executor(4);
+    const ui32 sum = sync_wait(sum_of_squares(executor, 100));
+
+    std::atomic<ui32> hopped = 0;
+    std::vector<task<void>> probes;
+    for (ui32 i = 0; i < 2000; i++) probes.push_back(probe_on(executor, std::this_thread::get_id(), hopped));
+    sync_wait(when_all(std::move(probes)));
+
+    std::vector<task<ui32>> sleepers;
+    for (ui32 ms : {80u, 80u, 1u}) sleepers.push_back(sleep_on(executor, ms));
+    const auto [first, slept] = sync_wait(when_any(std::move(sleepers)));
+
+    bool thrown = false;
+    std::vector<task<ui32>> failing;
+    failing.push_back(square_on(executor, 2));
+    failing.push_back(throw_on(executor));
+    try {
+        sync_wait(when_all(std::move(failing)));
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    const ui32 awaited = sync_wait(await_submit(executor));
+    executor.wait();
+    check(sum == 328350 && hopped == 2000 && first == 2 && slept == 1 && thrown && awaited == 42);
+}
+#endif
+
+/**
+ * @brief Check coroutines with every strategy, they need C++20.
+ */
+void check_coroutines()
+{
+#if defined(THREADPOOL_COROUTINES)
+    check_coroutine<YIELD_OR_SCHED_DURATION>("yield");
+    check_coroutine<CONDITION_VARIABLE>("condition variable");
+    check_coroutine<WORK_STEALING>("work stealing");
+    check_coroutine<LOCK_FREE>("lock free");
+#else
+    dual_println("Coroutines need C++20, skipped.");
+#endif
+}
+
+/**
+ * @brief Check that waiting sleeps instead of spinning, and that the waiting thread helps with queued tasks.
+ *
+ * @param name The name of the strategy.
+ * @param executor The pool to use.
+ */
+template <int strategy>
+void check_blocking_wait(const std::string &name, threadpool<strategy> &executor)
+{
+    dual_println("Checking that parallelize() and wait() do not burn a core while waiting (", name, ")...");
+    {
+        const std::clock_t cpu_start = std::clock();
+        const std::chrono::time_point<std::chrono::steady_clock> wall_start = std::chrono::steady_clock::now();
+        executor.parallelize(0, 4, [](const ui32 &, const ui32 &) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        });
+        executor.push([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        });
+        executor.wait();
+        const double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        const double wall =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+        dual_println("CPU time ", cpu, "s over ", wall, "s.");
+        check(cpu < wall / 2);
+    }
+    dual_println("Checking that a nested parallelize() on a single worker finishes (", name, ")...");
+    {
+        std::atomic<ui32> counter = 0;
+        executor.reset(1);
+        executor.push([&] {
+            executor.parallelize(0, 100, [&counter](const ui32 &start, const ui32 &end) {
+                counter += end - start;
+            });
+        });
+        executor.wait();
+        check(counter == 100);
+    }
+    dual_println("Checking that wait() from a task on a single worker runs the queued tasks and returns (", name,
+                 ")...");
+    {
+        std::atomic<ui32> counter = 0, seen = 0;
+        executor.push([&] {
+            for (ui32 i = 0; i < 10; i++) {
+                executor.push([&counter] {
+                    counter++;
+                });
+            }
+            executor.wait();
+            seen = counter.load();
+        });
+        executor.wait();
+        check(counter == 10 && seen == 10);
+        executor.reset(std::thread::hardware_concurrency());
+    }
+}
+
+/**
+ * @brief Check blocking waits with every strategy except yield, which polls by design.
+ */
+void check_blocking_waits()
+{
+    threadpool<CONDITION_VARIABLE> cv(2);
+    check_blocking_wait("condition variable", cv);
+    threadpool<WORK_STEALING> stealing(2);
+    check_blocking_wait("work stealing", stealing);
+    threadpool<LOCK_FREE> lockfree(2);
+    check_blocking_wait("lock free", lockfree);
+}
+
 /**
  * @brief A lightweight matrix class template for performance testing purposes. Not for general use; only contains the
  * bare minimum functionality needed for the test. Based on https://github.com/bshoshany/multithreaded-matrix
@@ -1198,6 +2323,319 @@ void check_performance()
     dual_println("\nOverall, multithreading provided speedups of up to ", max_speedup, "x.");
 }
 
+/**
+ * @brief Multiply two square matrices with one task per row on a private pool with the given strategy.
+ *
+ * @return std::pair containing the mean as the first member and standard deviation as the second member.
+ */
+template <int strategy>
+std::pair<double, double> time_fine_grained(const ui32 &workers, const matrix<double> &X, const matrix<double> &Y,
+                                            const ui64 &size)
+{
+    constexpr ui32 repeat = 10;
+    threadpool<strategy> executor(workers);
+    executor.set_duration(0);
+    matrix<double> C(size, size);
+    std::vector<i64> timings;
+    timer tmr;
+    for (ui32 n = 0; n < repeat; n++) {
+        tmr.start();
+        executor.parallelize(
+            0, size,
+            [&](const ui64 &start, const ui64 &end) {
+                for (ui64 i = start; i < end; i++)
+                    for (ui64 j = 0; j < size; j++) {
+                        C(i, j) = 0;
+                        for (ui64 k = 0; k < size; k++) C(i, j) += X(i, k) * Y(k, j);
+                    }
+            },
+            (ui32)size);
+        tmr.stop();
+        timings.push_back(tmr.ms());
+    }
+    return analyze(timings);
+}
+
+/**
+ * @brief Compare the scheduling strategies on fine-grained tasks with growing numbers of workers.
+ */
+void check_strategy_scaling()
+{
+    random_matrix_generator<double, std::uniform_real_distribution<double>> rnd(-1000, 1000);
+    const ui64 size = 128;
+    matrix<double> X = rnd.generate_matrix(size, size, pool.get_worker_size());
+    matrix<double> Y = rnd.generate_matrix(size, size, pool.get_worker_size());
+
+    dual_println("Multiplying two ", size, "x", size, " matrices with one task per row:");
+    for (ui32 workers : {std::thread::hardware_concurrency(), 32u, 64u}) {
+        auto cv = time_fine_grained<CONDITION_VARIABLE>(workers, X, Y, size);
+        auto yield = time_fine_grained<YIELD_OR_SCHED_DURATION>(workers, X, Y, size);
+        auto stealing = time_fine_grained<WORK_STEALING>(workers, X, Y, size);
+        auto lockfree = time_fine_grained<LOCK_FREE>(workers, X, Y, size);
+        dual_println("With ", std::setw(3), workers, " workers, mean execution time was ", std::setw(6), cv.first,
+                     " ms (condition variable), ", std::setw(6), yield.first, " ms (yield), ", std::setw(6),
+                     stealing.first, " ms (work stealing), ", std::setw(6), lockfree.first, " ms (lock free).");
+    }
+}
+
+/**
+ * @brief Multiply a lower triangular matrix by a square matrix, so that row i costs i + 1 times as much as the first
+ * row, with the given schedule on a work stealing pool.
+ *
+ * @return std::pair containing the mean as the first member and standard deviation as the second member.
+ */
+std::pair<double, double> time_skewed(const schedule &policy, const matrix<double> &X, const matrix<double> &Y,
+                                      const ui64 &size)
+{
+    constexpr ui32 repeat = 10;
+    threadpool<WORK_STEALING> executor;
+    matrix<double> C(size, size);
+    std::vector<i64> timings;
+    timer tmr;
+    for (ui32 n = 0; n < repeat; n++) {
+        tmr.start();
+        executor.parallelize(
+            0, size,
+            [&](const ui64 &start, const ui64 &end) {
+                for (ui64 i = start; i < end; i++)
+                    for (ui64 j = 0; j < size; j++) {
+                        C(i, j) = 0;
+                        for (ui64 k = 0; k <= i; k++) C(i, j) += X(i, k) * Y(k, j);
+                    }
+            },
+            policy);
+        tmr.stop();
+        timings.push_back(tmr.ms());
+    }
+    return analyze(timings);
+}
+
+/**
+ * @brief Compare the schedules on a workload whose cost grows with the index.
+ */
+void check_schedule_balance()
+{
+    random_matrix_generator<double, std::uniform_real_distribution<double>> rnd(-1000, 1000);
+    const ui64 size = 384;
+    matrix<double> X = rnd.generate_matrix(size, size, pool.get_worker_size());
+    matrix<double> Y = rnd.generate_matrix(size, size, pool.get_worker_size());
+
+    dual_println("Multiplying a ", size, "x", size, " lower triangular matrix by a square matrix:");
+    auto fixed = time_skewed(schedule::blocks(), X, Y, size);
+    auto dynamic = time_skewed(schedule::dynamic(4), X, Y, size);
+    auto guided = time_skewed(schedule::guided(), X, Y, size);
+    dual_println("Mean execution time was ", std::setw(6), fixed.first, " ms (static), ", std::setw(6), dynamic.first,
+                 " ms (dynamic), ", std::setw(6), guided.first, " ms (guided).");
+}
+
+/**
+ * @brief Time a callable over a few runs.
+ *
+ * @return The mean execution time in milliseconds.
+ */
+template <typename F>
+double time_mean(const F &function)
+{
+    constexpr ui32 repeat = 5;
+    std::vector<i64> timings;
+    timer tmr;
+    for (ui32 n = 0; n < repeat; n++) {
+        tmr.start();
+        function();
+        tmr.stop();
+        timings.push_back(tmr.ms());
+    }
+    return analyze(timings).first;
+}
+
+/**
+ * @brief Compare the parallel algorithms with the serial std versions.
+ */
+void check_algorithm_performance()
+{
+    const size_t size = 4000000;
+    std::mt19937_64 mt(42);
+    std::vector<double> input(size), output(size);
+    for (auto &value : input) value = (double)(mt() % 1000000);
+    threadpool<WORK_STEALING> executor;
+    auto work = [](const double &value) {
+        return std::sqrt(value) * std::log1p(value);
+    };
+
+    dual_println("Running the algorithms on ", size, " doubles, serial vs parallel:");
+    auto report = [](const std::string &label, double serial, double parallel) {
+        dual_println(std::setw(18), label, ": ", std::setw(6), serial, " ms vs ", std::setw(6), parallel, " ms.");
+    };
+    report(
+        "transform",
+        time_mean([&] {
+            std::transform(input.begin(), input.end(), output.begin(), work);
+        }),
+        time_mean([&] {
+            algorithms::transform(executor, input.begin(), input.end(), output.begin(), work);
+        }));
+    report(
+        "transform_reduce",
+        time_mean([&] {
+            volatile double sum = std::transform_reduce(input.begin(), input.end(), 0.0, std::plus<>(), work);
+            (void)sum;
+        }),
+        time_mean([&] {
+            volatile double sum =
+                algorithms::transform_reduce(executor, input.begin(), input.end(), 0.0, std::plus<>(), work);
+            (void)sum;
+        }));
+    report(
+        "inclusive_scan",
+        time_mean([&] {
+            std::inclusive_scan(input.begin(), input.end(), output.begin());
+        }),
+        time_mean([&] {
+            algorithms::inclusive_scan(executor, input.begin(), input.end(), output.begin());
+        }));
+    report(
+        "sort",
+        time_mean([&] {
+            output = input;
+            std::sort(output.begin(), output.end());
+        }),
+        time_mean([&] {
+            output = input;
+            algorithms::sort(executor, output.begin(), output.end());
+        }));
+}
+
+/**
+ * @brief Measure how long short interactive tasks wait behind bulk work, pushed in FIFO order and in priority lanes.
+ */
+void check_priority_latency()
+{
+    constexpr ui32 bulk = 2000, interactive = 20;
+    auto spin = [] {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(50);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    };
+    threadpool<CONDITION_VARIABLE> fifo;
+    std::vector<double> waits(interactive);
+    for (ui32 i = 0; i < bulk; i++) {
+        fifo.push(spin);
+        if (i % (bulk / interactive) == 0) {
+            fifo.push([&waits, i, pushed = std::chrono::steady_clock::now()] {
+                waits[i / (bulk / interactive)] =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pushed).count();
+            });
+        }
+    }
+    fifo.wait();
+    const double fifo_mean = std::accumulate(waits.begin(), waits.end(), 0.0) / interactive;
+
+    threadpool<CONDITION_VARIABLE> lanes;
+    for (ui32 i = 0; i < bulk; i++) {
+        lanes.push_prioritized(priority::LOW, spin);
+        if (i % (bulk / interactive) == 0) lanes.push_prioritized(priority::HIGH, [] {});
+    }
+    lanes.wait();
+    const lane_metrics high = lanes.get_lane_metrics(priority::HIGH), low = lanes.get_lane_metrics(priority::LOW);
+    auto ms = [](const std::chrono::nanoseconds &ns) {
+        return std::chrono::duration<double, std::milli>(ns).count();
+    };
+    dual_println(interactive, " interactive tasks among ", bulk, " bulk tasks of 50us:");
+    dual_println("FIFO: interactive tasks waited ", fifo_mean, " ms on average.");
+    dual_println("Lanes: interactive tasks waited ", ms(high.mean_latency), " ms on average (", ms(high.max_latency),
+                 " ms at most), bulk tasks ", ms(low.mean_latency), " ms (", ms(low.max_latency), " ms at most).");
+}
+
+/**
+ * @brief Push empty tasks from several producer threads at once into a private pool with the given strategy.
+ *
+ * @return The number of tasks pushed and executed per millisecond.
+ */
+template <int strategy>
+double time_contention(const ui32 &workers, const ui32 &producers, const ui32 &tasks)
+{
+    threadpool<strategy> executor(workers);
+    executor.set_duration(0);
+    std::atomic<ui32> executed = 0;
+    std::vector<std::thread> threads;
+    timer tmr;
+    tmr.start();
+    for (ui32 p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+            for (ui32 i = 0; i < tasks; i++) {
+                executor.push([&executed] {
+                    executed++;
+                });
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    executor.wait();
+    tmr.stop();
+    return (double)executed / (double)std::max<i64>(tmr.ms(), 1);
+}
+
+/**
+ * @brief Queue empty tasks into a private pool with the given strategy, one by one or as a single batch.
+ *
+ * @return The mean time per task in nanoseconds.
+ */
+template <int strategy>
+double time_batch(const ui32 &tasks, const bool &batched)
+{
+    threadpool<strategy> executor(std::max(std::thread::hardware_concurrency(), 4u));
+    std::atomic<ui32> executed = 0;
+    auto task = [&executed] {
+        executed++;
+    };
+    std::vector<decltype(task)> batch(tasks, task);
+    auto start = std::chrono::steady_clock::now();
+    if (batched) {
+        executor.push_batch(batch.begin(), batch.end()).wait();
+    } else {
+        for (ui32 i = 0; i < tasks; i++) executor.push(task);
+        executor.wait();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / tasks;
+}
+
+/**
+ * @brief Compare push() in a loop with one push_batch() for every strategy.
+ */
+void check_batch_performance()
+{
+    const ui32 tasks = 100000;
+    dual_println("Queueing ", tasks, " empty tasks, mean time per task in nanoseconds:");
+    dual_println("condition variable: ", std::setw(6), time_batch<CONDITION_VARIABLE>(tasks, false), " (push), ",
+                 std::setw(6), time_batch<CONDITION_VARIABLE>(tasks, true), " (push_batch).");
+    dual_println("yield:              ", std::setw(6), time_batch<YIELD_OR_SCHED_DURATION>(tasks, false), " (push), ",
+                 std::setw(6), time_batch<YIELD_OR_SCHED_DURATION>(tasks, true), " (push_batch).");
+    dual_println("work stealing:      ", std::setw(6), time_batch<WORK_STEALING>(tasks, false), " (push), ",
+                 std::setw(6), time_batch<WORK_STEALING>(tasks, true), " (push_batch).");
+    dual_println("lock free:          ", std::setw(6), time_batch<LOCK_FREE>(tasks, false), " (push), ",
+                 std::setw(6), time_batch<LOCK_FREE>(tasks, true), " (push_batch).");
+}
+
+/**
+ * @brief Compare the queues of all strategies when many threads push tiny tasks at the same time.
+ */
+void check_contention()
+{
+    const ui32 tasks = 20000;
+    const ui32 workers = std::max(std::thread::hardware_concurrency(), 4u);
+    dual_println("Pushing ", tasks, " empty tasks per producer into ", workers, " workers:");
+    for (ui32 producers : {1u, 4u, 16u}) {
+        auto cv = time_contention<CONDITION_VARIABLE>(workers, producers, tasks);
+        auto yield = time_contention<YIELD_OR_SCHED_DURATION>(workers, producers, tasks);
+        auto stealing = time_contention<WORK_STEALING>(workers, producers, tasks);
+        auto lockfree = time_contention<LOCK_FREE>(workers, producers, tasks);
+        dual_println("With ", std::setw(2), producers, " producers, throughput was ", std::setw(7), cv,
+                     " tasks/ms (condition variable), ", std::setw(7), yield, " tasks/ms (yield), ", std::setw(7),
+                     stealing, " tasks/ms (work stealing), ", std::setw(7), lockfree, " tasks/ms (lock free).");
+    }
+}
+
 int main()
 {
     std::string log_filename = "threadpool_test-" + get_time() + ".log";
@@ -1244,6 +2682,48 @@ int main()
     print_header("Checking that exception handling works:");
     check_exceptions();
 
+    print_header("Checking that the work stealing strategy works:");
+    check_work_stealing();
+
+    print_header("Checking that the lock free strategy works:");
+    check_lock_free();
+
+    print_header("Checking that batches work:");
+    check_batches();
+
+    print_header("Checking that schedules work:");
+    check_schedules();
+
+    print_header("Checking that the parallel algorithms work:");
+    check_algorithms();
+
+    print_header("Checking that task graphs work:");
+    check_task_graphs();
+
+    print_header("Checking that priorities work:");
+    check_priorities();
+
+    print_header("Checking that worker placement works:");
+    check_placement();
+
+    print_header("Checking that instrumentation works:");
+    check_instrumentation();
+
+    print_header("Checking that elastic pools work:");
+    check_elastics();
+
+    print_header("Checking that timers work:");
+    check_timers();
+
+    print_header("Checking that cancellation works:");
+    check_cancels();
+
+    print_header("Checking that coroutines work:");
+    check_coroutines();
+
+    print_header("Checking that waiting blocks and helps:");
+    check_blocking_waits();
+
     print_header("Testing that matrix operations produce the expected results:");
     check_matrix();
 
@@ -1251,6 +2731,18 @@ int main()
         print_header("SUCCESS: Passed all " + std::to_string(tests_succeeded) + " checks!", '+');
         print_header("Performing matrix performance test:");
         check_performance();
+        print_header("Comparing scheduling strategies:");
+        check_strategy_scaling();
+        print_header("Comparing schedules on a skewed workload:");
+        check_schedule_balance();
+        print_header("Comparing the parallel algorithms with std:");
+        check_algorithm_performance();
+        print_header("Comparing FIFO and priority lanes:");
+        check_priority_latency();
+        print_header("Comparing queues under contention:");
+        check_contention();
+        print_header("Comparing push() and push_batch():");
+        check_batch_performance();
         print_header("Thread pool performance test completed!", '+');
     } else {
         print_header("FAILURE: Passed " + std::to_string(tests_succeeded) + " checks, but failed "
@@ -1260,5 +2752,5 @@ int main()
                      "exact specifications of your system (OS, CPU, compiler, etc.) and the generated log file.");
     }
 
-    return 0;
+    return tests_failed == 0 ? 0 : 1;
 }
@@ -19,15 +19,27 @@
 #include <cctype>
 #include <cassert>
 #include <sstream>
+#include <memory>
 #include <functional>
-#include <locale>
-#include <clocale>
-#include <wchar.h>
 #include <math.h>
 #include <iostream>
 #include <algorithm>
-#include <regex>
 #include <iomanip>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <optional>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #if defined(__GNUC__)
 #pragma GCC diagnostic ignored "-Wswitch-enum"
@@ -119,6 +131,16 @@ struct TrueColor {
         return hex == DEFAULT;
     }
 
+    bool operator==(const TrueColor &other) const
+    {
+        return hex == other.hex && color == other.color;
+    }
+
+    bool operator!=(const TrueColor &other) const
+    {
+        return !(*this == other);
+    }
+
 #define BYTEn(v, n) (((v) >> ((n)*8)) & 0xFF)
     std::tuple<unsigned char, unsigned char, unsigned char> RGB() const
     {
@@ -195,10 +217,10 @@ using Styles = std::vector<Style>;
 using StringFormatter = std::function<std::string(const std::string &, TrueColor, TrueColor, const Styles &)>;
 using BorderFormatter =
     std::function<std::string(Which which, const Cell *self, const Cell *left, const Cell *right, const Cell *top,
-                              const Cell *bottom, size_t expect_size, StringFormatter stringformater)>;
+                              const Cell *bottom, size_t expect_size, const StringFormatter &stringformater)>;
 using CornerFormatter =
     std::function<std::string(Which which, const Cell *self, const Cell *top_left, const Cell *top_right,
-                              const Cell *bottom_left, const Cell *bottom_right, StringFormatter stringformater)>;
+                              const Cell *bottom_left, const Cell *bottom_right, const StringFormatter &stringformater)>;
 } // namespace tabulate
 
 namespace tabulate
@@ -297,56 +319,313 @@ namespace tabulate
 {
 static const std::string NEWLINE = "\n";
 
-static size_t display_width_of(const std::string &text, const std::string &locale, bool wchar_enabled)
-{
-    // delete ansi escape sequences
-    std::regex e("\x1b(?:[@-Z\\-_]|\\[[0-?]*[ -/]*[@-~])");
-    std::string str = std::regex_replace(text, e, "");
+/**
+ * Policy to measure the display width of multi-byte characters. It's built from tables compiled into this header and
+ * never touches the global locale, so tables can be rendered from several threads at once.
+ */
+struct UnicodePolicy {
+    unsigned ambiguous_width; // East Asian Ambiguous characters, e.g. '±' or 'Я', wide in CJK contexts
+    unsigned emoji_width;     // characters with emoji presentation
 
-    if (!wchar_enabled) {
-        return str.length();
+    UnicodePolicy(unsigned ambiguous_width = 1, unsigned emoji_width = 2)
+        : ambiguous_width(ambiguous_width), emoji_width(emoji_width)
+    {
     }
 
-    if (str.size() == 0) {
-        return 0;
+    bool operator==(const UnicodePolicy &other) const
+    {
+        return ambiguous_width == other.ambiguous_width && emoji_width == other.emoji_width;
     }
 
-    // XXX: Markus Kuhn's open-source wcswidth.c
-#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+    // the policy a locale stands for, only the language matters, e.g. "zh_CN.UTF-8" treats ambiguous as wide
+    static UnicodePolicy from_locale(const std::string &locale)
     {
-        // The behavior of wcswidth() depends on the LC_CTYPE category of the current locale.
-        // Set the current locale based on cell properties before computing width
-        auto old_locale = std::locale::global(std::locale(locale));
-
-        // Convert from narrow std::string to wide string
-        wchar_t stackbuff[128], *wstr = stackbuff;
-        if (str.size() > 128) {
-            wstr = new wchar_t[str.size()];
+        if (locale.size() >= 2) {
+            std::string language = locale.substr(0, 2);
+            if (language == "zh" || language == "ja" || language == "ko") {
+                return UnicodePolicy(2);
+            }
         }
+        return UnicodePolicy();
+    }
+};
 
-        std::mbstowcs(wstr, str.c_str(), str.size());
+struct UnicodeRange {
+    char32_t first, last;
+};
 
-        // Compute display width of wide string
-        int len = wcswidth(wstr, str.size());
+// clang-format off
+// generated from Unicode 14.0 character database: general category Mn, Me and Cf, Hangul Jamo medial vowels and
+// final consonants
+static const UnicodeRange zero_width_ranges[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0600, 0x0605}, {0x0610, 0x061A}, {0x061C, 0x061C},
+    {0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DD}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8},
+    {0x06EA, 0x06ED}, {0x070F, 0x070F}, {0x0711, 0x0711}, {0x0730, 0x074A}, {0x07A6, 0x07B0},
+    {0x07EB, 0x07F3}, {0x07FD, 0x07FD}, {0x0816, 0x0819}, {0x081B, 0x0823}, {0x0825, 0x0827},
+    {0x0829, 0x082D}, {0x0859, 0x085B}, {0x0890, 0x0891}, {0x0898, 0x089F}, {0x08CA, 0x0902},
+    {0x093A, 0x093A}, {0x093C, 0x093C}, {0x0941, 0x0948}, {0x094D, 0x094D}, {0x0951, 0x0957},
+    {0x0962, 0x0963}, {0x0981, 0x0981}, {0x09BC, 0x09BC}, {0x09C1, 0x09C4}, {0x09CD, 0x09CD},
+    {0x09E2, 0x09E3}, {0x09FE, 0x09FE}, {0x0A01, 0x0A02}, {0x0A3C, 0x0A3C}, {0x0A41, 0x0A42},
+    {0x0A47, 0x0A48}, {0x0A4B, 0x0A4D}, {0x0A51, 0x0A51}, {0x0A70, 0x0A71}, {0x0A75, 0x0A75},
+    {0x0A81, 0x0A82}, {0x0ABC, 0x0ABC}, {0x0AC1, 0x0AC5}, {0x0AC7, 0x0AC8}, {0x0ACD, 0x0ACD},
+    {0x0AE2, 0x0AE3}, {0x0AFA, 0x0AFF}, {0x0B01, 0x0B01}, {0x0B3C, 0x0B3C}, {0x0B3F, 0x0B3F},
+    {0x0B41, 0x0B44}, {0x0B4D, 0x0B4D}, {0x0B55, 0x0B56}, {0x0B62, 0x0B63}, {0x0B82, 0x0B82},
+    {0x0BC0, 0x0BC0}, {0x0BCD, 0x0BCD}, {0x0C00, 0x0C00}, {0x0C04, 0x0C04}, {0x0C3C, 0x0C3C},
+    {0x0C3E, 0x0C40}, {0x0C46, 0x0C48}, {0x0C4A, 0x0C4D}, {0x0C55, 0x0C56}, {0x0C62, 0x0C63},
+    {0x0C81, 0x0C81}, {0x0CBC, 0x0CBC}, {0x0CBF, 0x0CBF}, {0x0CC6, 0x0CC6}, {0x0CCC, 0x0CCD},
+    {0x0CE2, 0x0CE3}, {0x0D00, 0x0D01}, {0x0D3B, 0x0D3C}, {0x0D41, 0x0D44}, {0x0D4D, 0x0D4D},
+    {0x0D62, 0x0D63}, {0x0D81, 0x0D81}, {0x0DCA, 0x0DCA}, {0x0DD2, 0x0DD4}, {0x0DD6, 0x0DD6},
+    {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x0EB1, 0x0EB1}, {0x0EB4, 0x0EBC},
+    {0x0EC8, 0x0ECD}, {0x0F18, 0x0F19}, {0x0F35, 0x0F35}, {0x0F37, 0x0F37}, {0x0F39, 0x0F39},
+    {0x0F71, 0x0F7E}, {0x0F80, 0x0F84}, {0x0F86, 0x0F87}, {0x0F8D, 0x0F97}, {0x0F99, 0x0FBC},
+    {0x0FC6, 0x0FC6}, {0x102D, 0x1030}, {0x1032, 0x1037}, {0x1039, 0x103A}, {0x103D, 0x103E},
+    {0x1058, 0x1059}, {0x105E, 0x1060}, {0x1071, 0x1074}, {0x1082, 0x1082}, {0x1085, 0x1086},
+    {0x108D, 0x108D}, {0x109D, 0x109D}, {0x1160, 0x11FF}, {0x135D, 0x135F}, {0x1712, 0x1714},
+    {0x1732, 0x1733}, {0x1752, 0x1753}, {0x1772, 0x1773}, {0x17B4, 0x17B5}, {0x17B7, 0x17BD},
+    {0x17C6, 0x17C6}, {0x17C9, 0x17D3}, {0x17DD, 0x17DD}, {0x180B, 0x180F}, {0x1885, 0x1886},
+    {0x18A9, 0x18A9}, {0x1920, 0x1922}, {0x1927, 0x1928}, {0x1932, 0x1932}, {0x1939, 0x193B},
+    {0x1A17, 0x1A18}, {0x1A1B, 0x1A1B}, {0x1A56, 0x1A56}, {0x1A58, 0x1A5E}, {0x1A60, 0x1A60},
+    {0x1A62, 0x1A62}, {0x1A65, 0x1A6C}, {0x1A73, 0x1A7C}, {0x1A7F, 0x1A7F}, {0x1AB0, 0x1ACE},
+    {0x1B00, 0x1B03}, {0x1B34, 0x1B34}, {0x1B36, 0x1B3A}, {0x1B3C, 0x1B3C}, {0x1B42, 0x1B42},
+    {0x1B6B, 0x1B73}, {0x1B80, 0x1B81}, {0x1BA2, 0x1BA5}, {0x1BA8, 0x1BA9}, {0x1BAB, 0x1BAD},
+    {0x1BE6, 0x1BE6}, {0x1BE8, 0x1BE9}, {0x1BED, 0x1BED}, {0x1BEF, 0x1BF1}, {0x1C2C, 0x1C33},
+    {0x1C36, 0x1C37}, {0x1CD0, 0x1CD2}, {0x1CD4, 0x1CE0}, {0x1CE2, 0x1CE8}, {0x1CED, 0x1CED},
+    {0x1CF4, 0x1CF4}, {0x1CF8, 0x1CF9}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x202A, 0x202E},
+    {0x2060, 0x2064}, {0x2066, 0x206F}, {0x20D0, 0x20F0}, {0x2CEF, 0x2CF1}, {0x2D7F, 0x2D7F},
+    {0x2DE0, 0x2DFF}, {0x302A, 0x302D}, {0x3099, 0x309A}, {0xA66F, 0xA672}, {0xA674, 0xA67D},
+    {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1}, {0xA802, 0xA802}, {0xA806, 0xA806}, {0xA80B, 0xA80B},
+    {0xA825, 0xA826}, {0xA82C, 0xA82C}, {0xA8C4, 0xA8C5}, {0xA8E0, 0xA8F1}, {0xA8FF, 0xA8FF},
+    {0xA926, 0xA92D}, {0xA947, 0xA951}, {0xA980, 0xA982}, {0xA9B3, 0xA9B3}, {0xA9B6, 0xA9B9},
+    {0xA9BC, 0xA9BD}, {0xA9E5, 0xA9E5}, {0xAA29, 0xAA2E}, {0xAA31, 0xAA32}, {0xAA35, 0xAA36},
+    {0xAA43, 0xAA43}, {0xAA4C, 0xAA4C}, {0xAA7C, 0xAA7C}, {0xAAB0, 0xAAB0}, {0xAAB2, 0xAAB4},
+    {0xAAB7, 0xAAB8}, {0xAABE, 0xAABF}, {0xAAC1, 0xAAC1}, {0xAAEC, 0xAAED}, {0xAAF6, 0xAAF6},
+    {0xABE5, 0xABE5}, {0xABE8, 0xABE8}, {0xABED, 0xABED}, {0xFB1E, 0xFB1E}, {0xFE00, 0xFE0F},
+    {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xFFF9, 0xFFFB}, {0x101FD, 0x101FD}, {0x102E0, 0x102E0},
+    {0x10376, 0x1037A}, {0x10A01, 0x10A03}, {0x10A05, 0x10A06}, {0x10A0C, 0x10A0F}, {0x10A38, 0x10A3A},
+    {0x10A3F, 0x10A3F}, {0x10AE5, 0x10AE6}, {0x10D24, 0x10D27}, {0x10EAB, 0x10EAC}, {0x10F46, 0x10F50},
+    {0x10F82, 0x10F85}, {0x11001, 0x11001}, {0x11038, 0x11046}, {0x11070, 0x11070}, {0x11073, 0x11074},
+    {0x1107F, 0x11081}, {0x110B3, 0x110B6}, {0x110B9, 0x110BA}, {0x110BD, 0x110BD}, {0x110C2, 0x110C2},
+    {0x110CD, 0x110CD}, {0x11100, 0x11102}, {0x11127, 0x1112B}, {0x1112D, 0x11134}, {0x11173, 0x11173},
+    {0x11180, 0x11181}, {0x111B6, 0x111BE}, {0x111C9, 0x111CC}, {0x111CF, 0x111CF}, {0x1122F, 0x11231},
+    {0x11234, 0x11234}, {0x11236, 0x11237}, {0x1123E, 0x1123E}, {0x112DF, 0x112DF}, {0x112E3, 0x112EA},
+    {0x11300, 0x11301}, {0x1133B, 0x1133C}, {0x11340, 0x11340}, {0x11366, 0x1136C}, {0x11370, 0x11374},
+    {0x11438, 0x1143F}, {0x11442, 0x11444}, {0x11446, 0x11446}, {0x1145E, 0x1145E}, {0x114B3, 0x114B8},
+    {0x114BA, 0x114BA}, {0x114BF, 0x114C0}, {0x114C2, 0x114C3}, {0x115B2, 0x115B5}, {0x115BC, 0x115BD},
+    {0x115BF, 0x115C0}, {0x115DC, 0x115DD}, {0x11633, 0x1163A}, {0x1163D, 0x1163D}, {0x1163F, 0x11640},
+    {0x116AB, 0x116AB}, {0x116AD, 0x116AD}, {0x116B0, 0x116B5}, {0x116B7, 0x116B7}, {0x1171D, 0x1171F},
+    {0x11722, 0x11725}, {0x11727, 0x1172B}, {0x1182F, 0x11837}, {0x11839, 0x1183A}, {0x1193B, 0x1193C},
+    {0x1193E, 0x1193E}, {0x11943, 0x11943}, {0x119D4, 0x119D7}, {0x119DA, 0x119DB}, {0x119E0, 0x119E0},
+    {0x11A01, 0x11A0A}, {0x11A33, 0x11A38}, {0x11A3B, 0x11A3E}, {0x11A47, 0x11A47}, {0x11A51, 0x11A56},
+    {0x11A59, 0x11A5B}, {0x11A8A, 0x11A96}, {0x11A98, 0x11A99}, {0x11C30, 0x11C36}, {0x11C38, 0x11C3D},
+    {0x11C3F, 0x11C3F}, {0x11C92, 0x11CA7}, {0x11CAA, 0x11CB0}, {0x11CB2, 0x11CB3}, {0x11CB5, 0x11CB6},
+    {0x11D31, 0x11D36}, {0x11D3A, 0x11D3A}, {0x11D3C, 0x11D3D}, {0x11D3F, 0x11D45}, {0x11D47, 0x11D47},
+    {0x11D90, 0x11D91}, {0x11D95, 0x11D95}, {0x11D97, 0x11D97}, {0x11EF3, 0x11EF4}, {0x13430, 0x13438},
+    {0x16AF0, 0x16AF4}, {0x16B30, 0x16B36}, {0x16F4F, 0x16F4F}, {0x16F8F, 0x16F92}, {0x16FE4, 0x16FE4},
+    {0x1BC9D, 0x1BC9E}, {0x1BCA0, 0x1BCA3}, {0x1CF00, 0x1CF2D}, {0x1CF30, 0x1CF46}, {0x1D167, 0x1D169},
+    {0x1D173, 0x1D182}, {0x1D185, 0x1D18B}, {0x1D1AA, 0x1D1AD}, {0x1D242, 0x1D244}, {0x1DA00, 0x1DA36},
+    {0x1DA3B, 0x1DA6C}, {0x1DA75, 0x1DA75}, {0x1DA84, 0x1DA84}, {0x1DA9B, 0x1DA9F}, {0x1DAA1, 0x1DAAF},
+    {0x1E000, 0x1E006}, {0x1E008, 0x1E018}, {0x1E01B, 0x1E021}, {0x1E023, 0x1E024}, {0x1E026, 0x1E02A},
+    {0x1E130, 0x1E136}, {0x1E2AE, 0x1E2AE}, {0x1E2EC, 0x1E2EF}, {0x1E8D0, 0x1E8D6}, {0x1E944, 0x1E94A},
+    {0xE0001, 0xE0001}, {0xE0020, 0xE007F}, {0xE0100, 0xE01EF},
+};
 
-        if (wstr != stackbuff) {
-            delete[] wstr;
-        }
+// East Asian Width W and F
+static const UnicodeRange wide_ranges[] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x2E99}, {0x2E9B, 0x2EF3}, {0x2F00, 0x2FD5}, {0x2FF0, 0x2FFB}, {0x3000, 0x3029},
+    {0x302E, 0x303E}, {0x3041, 0x3096}, {0x309B, 0x30FF}, {0x3105, 0x312F}, {0x3131, 0x318E},
+    {0x3190, 0x31E3}, {0x31F0, 0x321E}, {0x3220, 0x3247}, {0x3250, 0x4DBF}, {0x4E00, 0xA48C},
+    {0xA490, 0xA4C6}, {0xA960, 0xA97C}, {0xAC00, 0xD7A3}, {0xF900, 0xFA6D}, {0xFA70, 0xFAD9},
+    {0xFE10, 0xFE19}, {0xFE30, 0xFE52}, {0xFE54, 0xFE66}, {0xFE68, 0xFE6B}, {0xFF01, 0xFF60},
+    {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE3}, {0x16FF0, 0x16FF1}, {0x17000, 0x187F7}, {0x18800, 0x18CD5},
+    {0x18D00, 0x18D08}, {0x1AFF0, 0x1AFF3}, {0x1AFF5, 0x1AFFB}, {0x1AFFD, 0x1AFFE}, {0x1B000, 0x1B122},
+    {0x1B150, 0x1B152}, {0x1B164, 0x1B167}, {0x1B170, 0x1B2FB}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+    {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B}, {0x1F240, 0x1F248},
+    {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C},
+    {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4},
+    {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E},
+    {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F},
+    {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DD, 0x1F6DF},
+    {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB}, {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A},
+    {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FA74}, {0x1FA78, 0x1FA7C}, {0x1FA80, 0x1FA86},
+    {0x1FA90, 0x1FAAC}, {0x1FAB0, 0x1FABA}, {0x1FAC0, 0x1FAC5}, {0x1FAD0, 0x1FAD9}, {0x1FAE0, 0x1FAE7},
+    {0x1FAF0, 0x1FAF6}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
 
-        // Restore old locale
-        std::locale::global(old_locale);
+// East Asian Width A
+static const UnicodeRange ambiguous_ranges[] = {
+    {0x00A1, 0x00A1}, {0x00A4, 0x00A4}, {0x00A7, 0x00A8}, {0x00AA, 0x00AA}, {0x00AD, 0x00AE},
+    {0x00B0, 0x00B4}, {0x00B6, 0x00BA}, {0x00BC, 0x00BF}, {0x00C6, 0x00C6}, {0x00D0, 0x00D0},
+    {0x00D7, 0x00D8}, {0x00DE, 0x00E1}, {0x00E6, 0x00E6}, {0x00E8, 0x00EA}, {0x00EC, 0x00ED},
+    {0x00F0, 0x00F0}, {0x00F2, 0x00F3}, {0x00F7, 0x00FA}, {0x00FC, 0x00FC}, {0x00FE, 0x00FE},
+    {0x0101, 0x0101}, {0x0111, 0x0111}, {0x0113, 0x0113}, {0x011B, 0x011B}, {0x0126, 0x0127},
+    {0x012B, 0x012B}, {0x0131, 0x0133}, {0x0138, 0x0138}, {0x013F, 0x0142}, {0x0144, 0x0144},
+    {0x0148, 0x014B}, {0x014D, 0x014D}, {0x0152, 0x0153}, {0x0166, 0x0167}, {0x016B, 0x016B},
+    {0x01CE, 0x01CE}, {0x01D0, 0x01D0}, {0x01D2, 0x01D2}, {0x01D4, 0x01D4}, {0x01D6, 0x01D6},
+    {0x01D8, 0x01D8}, {0x01DA, 0x01DA}, {0x01DC, 0x01DC}, {0x0251, 0x0251}, {0x0261, 0x0261},
+    {0x02C4, 0x02C4}, {0x02C7, 0x02C7}, {0x02C9, 0x02CB}, {0x02CD, 0x02CD}, {0x02D0, 0x02D0},
+    {0x02D8, 0x02DB}, {0x02DD, 0x02DD}, {0x02DF, 0x02DF}, {0x0391, 0x03A1}, {0x03A3, 0x03A9},
+    {0x03B1, 0x03C1}, {0x03C3, 0x03C9}, {0x0401, 0x0401}, {0x0410, 0x044F}, {0x0451, 0x0451},
+    {0x2010, 0x2010}, {0x2013, 0x2016}, {0x2018, 0x2019}, {0x201C, 0x201D}, {0x2020, 0x2022},
+    {0x2024, 0x2027}, {0x2030, 0x2030}, {0x2032, 0x2033}, {0x2035, 0x2035}, {0x203B, 0x203B},
+    {0x203E, 0x203E}, {0x2074, 0x2074}, {0x207F, 0x207F}, {0x2081, 0x2084}, {0x20AC, 0x20AC},
+    {0x2103, 0x2103}, {0x2105, 0x2105}, {0x2109, 0x2109}, {0x2113, 0x2113}, {0x2116, 0x2116},
+    {0x2121, 0x2122}, {0x2126, 0x2126}, {0x212B, 0x212B}, {0x2153, 0x2154}, {0x215B, 0x215E},
+    {0x2160, 0x216B}, {0x2170, 0x2179}, {0x2189, 0x2189}, {0x2190, 0x2199}, {0x21B8, 0x21B9},
+    {0x21D2, 0x21D2}, {0x21D4, 0x21D4}, {0x21E7, 0x21E7}, {0x2200, 0x2200}, {0x2202, 0x2203},
+    {0x2207, 0x2208}, {0x220B, 0x220B}, {0x220F, 0x220F}, {0x2211, 0x2211}, {0x2215, 0x2215},
+    {0x221A, 0x221A}, {0x221D, 0x2220}, {0x2223, 0x2223}, {0x2225, 0x2225}, {0x2227, 0x222C},
+    {0x222E, 0x222E}, {0x2234, 0x2237}, {0x223C, 0x223D}, {0x2248, 0x2248}, {0x224C, 0x224C},
+    {0x2252, 0x2252}, {0x2260, 0x2261}, {0x2264, 0x2267}, {0x226A, 0x226B}, {0x226E, 0x226F},
+    {0x2282, 0x2283}, {0x2286, 0x2287}, {0x2295, 0x2295}, {0x2299, 0x2299}, {0x22A5, 0x22A5},
+    {0x22BF, 0x22BF}, {0x2312, 0x2312}, {0x2460, 0x24E9}, {0x24EB, 0x254B}, {0x2550, 0x2573},
+    {0x2580, 0x258F}, {0x2592, 0x2595}, {0x25A0, 0x25A1}, {0x25A3, 0x25A9}, {0x25B2, 0x25B3},
+    {0x25B6, 0x25B7}, {0x25BC, 0x25BD}, {0x25C0, 0x25C1}, {0x25C6, 0x25C8}, {0x25CB, 0x25CB},
+    {0x25CE, 0x25D1}, {0x25E2, 0x25E5}, {0x25EF, 0x25EF}, {0x2605, 0x2606}, {0x2609, 0x2609},
+    {0x260E, 0x260F}, {0x261C, 0x261C}, {0x261E, 0x261E}, {0x2640, 0x2640}, {0x2642, 0x2642},
+    {0x2660, 0x2661}, {0x2663, 0x2665}, {0x2667, 0x266A}, {0x266C, 0x266D}, {0x266F, 0x266F},
+    {0x269E, 0x269F}, {0x26BF, 0x26BF}, {0x26C6, 0x26CD}, {0x26CF, 0x26D3}, {0x26D5, 0x26E1},
+    {0x26E3, 0x26E3}, {0x26E8, 0x26E9}, {0x26EB, 0x26F1}, {0x26F4, 0x26F4}, {0x26F6, 0x26F9},
+    {0x26FB, 0x26FC}, {0x26FE, 0x26FF}, {0x273D, 0x273D}, {0x2776, 0x277F}, {0x2B56, 0x2B59},
+    {0x3248, 0x324F}, {0xFFFD, 0xFFFD}, {0x1F100, 0x1F10A}, {0x1F110, 0x1F12D}, {0x1F130, 0x1F169},
+    {0x1F170, 0x1F18D}, {0x1F18F, 0x1F190}, {0x1F19B, 0x1F1AC},
+};
+
+// wide characters with emoji presentation
+static const UnicodeRange emoji_ranges[] = {
+    {0x231A, 0x231B}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE},
+    {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+    {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE}, {0x26D4, 0x26D4},
+    {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5}, {0x26FA, 0x26FA}, {0x26FD, 0x26FD},
+    {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E},
+    {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF},
+    {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+    {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B}, {0x1F240, 0x1F248},
+    {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C},
+    {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4},
+    {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E},
+    {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F},
+    {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DD, 0x1F6DF},
+    {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB}, {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A},
+    {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FA74}, {0x1FA78, 0x1FA7C}, {0x1FA80, 0x1FA86},
+    {0x1FA90, 0x1FAAC}, {0x1FAB0, 0x1FABA}, {0x1FAC0, 0x1FAC5}, {0x1FAD0, 0x1FAD9}, {0x1FAE0, 0x1FAE7},
+    {0x1FAF0, 0x1FAF6},
+};
+// clang-format on
 
-        if (len >= 0) {
-            return len;
+static bool in_unicode_ranges(char32_t cp, const UnicodeRange *begin, const UnicodeRange *end)
+{
+    auto it = std::upper_bound(begin, end, cp, [](char32_t value, const UnicodeRange &range) {
+        return value < range.first;
+    });
+    return it != begin && cp <= (it - 1)->last;
+}
+
+#define IN_UNICODE_RANGES(cp, ranges) in_unicode_ranges(cp, std::begin(ranges), std::end(ranges))
+static size_t codepoint_width_of(char32_t cp, const UnicodePolicy &policy)
+{
+    if (cp < 0xA1) { // below the first ambiguous and zero-width characters
+        return cp == 0 ? 0 : 1;
+    }
+    if (IN_UNICODE_RANGES(cp, zero_width_ranges)) {
+        return 0;
+    }
+    if (IN_UNICODE_RANGES(cp, emoji_ranges)) {
+        return policy.emoji_width;
+    }
+    if (IN_UNICODE_RANGES(cp, wide_ranges)) {
+        return 2;
+    }
+    if (IN_UNICODE_RANGES(cp, ambiguous_ranges)) {
+        return policy.ambiguous_width;
+    }
+    return 1;
+}
+#undef IN_UNICODE_RANGES
+
+// length of the ANSI escape sequence starting at p(ESC), or 0 if it's not a complete one
+static size_t ansi_escape_length(const char *p, const char *end)
+{
+    if (end - p < 2) {
+        return 0;
+    }
+    unsigned char c = static_cast<unsigned char>(p[1]);
+    if (c != '[') {
+        // Fe escape sequence: ESC [@-Z\]^_]
+        return (c >= 0x40 && c <= 0x5F) ? 2 : 0;
+    }
+
+    // CSI: ESC [ parameter bytes[0-?]* intermediate bytes[ -/]* final byte[@-~]
+    const char *q = p + 2;
+    while (q < end && *q >= 0x30 && *q <= 0x3F) {
+        q++;
+    }
+    while (q < end && *q >= 0x20 && *q <= 0x2F) {
+        q++;
+    }
+    if (q < end && *q >= 0x40 && *q <= 0x7E) {
+        return static_cast<size_t>(q + 1 - p);
+    }
+    return 0;
+}
+
+// decode one UTF-8 sequence and advance p, an invalid byte is decoded as U+FFFD and skipped
+static char32_t decode_utf8(const char *&p, const char *end)
+{
+    unsigned char c = static_cast<unsigned char>(*p);
+    size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+    if (length == 0 || static_cast<size_t>(end - p) < length) {
+        p++;
+        return (c & 0xC0) == 0x80 ? 0 : 0xFFFD; // a stray continuation byte takes no space
+    }
+
+    char32_t cp = length == 1 ? c : (c & (0x7F >> length));
+    for (size_t i = 1; i < length; i++) {
+        unsigned char cc = static_cast<unsigned char>(p[i]);
+        if ((cc & 0xC0) != 0x80) {
+            p++;
+            return 0xFFFD;
         }
+        cp = (cp << 6) | (cc & 0x3F);
     }
-#endif
+    p += length;
+    return cp;
+}
 
-    {
-        return (str.length() - std::count_if(str.begin(), str.end(), [](char c) -> bool {
-                    return (c & 0xC0) == 0x80;
-                }));
+static size_t display_width_of(const std::string &text, const UnicodePolicy &policy, bool wchar_enabled)
+{
+    size_t width = 0;
+    const char *p = text.data(), *end = text.data() + text.size();
+    while (p < end) {
+        if (*p == '\x1b') {
+            // skip ansi escape sequences
+            size_t length = ansi_escape_length(p, end);
+            if (length > 0) {
+                p += length;
+                continue;
+            }
+        }
+        if (!wchar_enabled || static_cast<unsigned char>(*p) < 0x80) {
+            width++;
+            p++;
+        } else {
+            width += codepoint_width_of(decode_utf8(p, end), policy);
+        }
     }
+
+    return width;
+}
+
+inline size_t display_width_of(const std::string &text, const std::string &locale, bool wchar_enabled)
+{
+    return display_width_of(text, UnicodePolicy::from_locale(locale), wchar_enabled);
 }
 } // namespace tabulate
 
@@ -415,7 +694,7 @@ static std::vector<std::string> explode_string(const std::string &input, const s
     return segments;
 }
 
-static std::vector<std::string> wrap_lines(const std::string &str, size_t width, const std::string &locale,
+static std::vector<std::string> wrap_lines(const std::string &str, size_t width, const UnicodePolicy &policy,
                                            bool multi_bytes_character)
 {
     std::vector<std::string> lines;
@@ -425,15 +704,15 @@ static std::vector<std::string> wrap_lines(const std::string &str, size_t width,
         while (std::getline(ss, line, '\n')) {
             std::string wrapped;
             for (auto &word : explode_string(line, {" ", "-", "\t"})) {
-                if (display_width_of(wrapped, locale, multi_bytes_character)
-                        + display_width_of(word, locale, multi_bytes_character)
+                if (display_width_of(wrapped, policy, multi_bytes_character)
+                        + display_width_of(word, policy, multi_bytes_character)
                     > width) {
-                    if (display_width_of(wrapped, locale, multi_bytes_character) > 0) {
+                    if (display_width_of(wrapped, policy, multi_bytes_character) > 0) {
                         lines.push_back(wrapped);
                         wrapped = "";
                     }
 
-                    while (display_width_of(word, locale, multi_bytes_character) > width) {
+                    while (display_width_of(word, policy, multi_bytes_character) > width) {
                         wrapped = word.substr(0, width - 1) + "-";
                         lines.push_back(wrapped);
                         wrapped = "";
@@ -452,23 +731,129 @@ static std::vector<std::string> wrap_lines(const std::string &str, size_t width,
     return lines;
 }
 
-static std::string expand_to_size(const std::string &s, size_t len, bool multi_bytes_character = true)
+inline std::vector<std::string> wrap_lines(const std::string &str, size_t width, const std::string &locale,
+                                           bool multi_bytes_character)
 {
-    std::string r;
-    if (s == "") {
-        return std::string(' ', len);
+    return wrap_lines(str, width, UnicodePolicy::from_locale(locale), multi_bytes_character);
+}
+
+// slot of a glyph in a Theme, none means a user customised border string
+enum class Glyph : int8_t {
+    none = -1,
+    vertical,
+    horizontal,
+    top_left,
+    top_mid,
+    top_right,
+    mid_left,
+    mid_mid,
+    mid_right,
+    bottom_left,
+    bottom_mid,
+    bottom_right,
+};
+
+/**
+ * Compile-time border presets. Every glyph of a theme has the same, known display width, so borders can be
+ * expanded without measuring the glyph again for each cell.
+ */
+struct Theme {
+    std::string_view vertical, horizontal;
+    std::string_view top_left, top_mid, top_right;
+    std::string_view mid_left, mid_mid, mid_right;
+    std::string_view bottom_left, bottom_mid, bottom_right;
+    size_t width;     // display width of each glyph
+    bool header_only; // only draw the rule below the header, like markdown
+
+    constexpr std::string_view glyph(Glyph which) const
+    {
+        constexpr std::string_view Theme::*slots[] = {
+            &Theme::vertical,  &Theme::horizontal, &Theme::top_left,    &Theme::top_mid,
+            &Theme::top_right, &Theme::mid_left,   &Theme::mid_mid,     &Theme::mid_right,
+            &Theme::bottom_left, &Theme::bottom_mid, &Theme::bottom_right,
+        };
+        return which == Glyph::none ? std::string_view() : this->*slots[static_cast<int>(which)];
+    }
+
+    constexpr bool operator==(const Theme &other) const
+    {
+        return vertical == other.vertical && horizontal == other.horizontal && top_left == other.top_left
+               && top_mid == other.top_mid && top_right == other.top_right && mid_left == other.mid_left
+               && mid_mid == other.mid_mid && mid_right == other.mid_right && bottom_left == other.bottom_left
+               && bottom_mid == other.bottom_mid && bottom_right == other.bottom_right && width == other.width
+               && header_only == other.header_only;
+    }
+};
+
+namespace themes
+{
+// clang-format off
+constexpr Theme ascii    = {"|", "-", "+", "+", "+", "+", "+", "+", "+", "+", "+", 1, false};
+constexpr Theme unicode  = {"│", "─", "┌", "┬", "┐", "├", "┼", "┤", "└", "┴", "┘", 1, false};
+constexpr Theme heavy    = {"┃", "━", "┏", "┳", "┓", "┣", "╋", "┫", "┗", "┻", "┛", 1, false};
+constexpr Theme doubled  = {"║", "═", "╔", "╦", "╗", "╠", "╬", "╣", "╚", "╩", "╝", 1, false};
+constexpr Theme markdown = {"|", "-", "|", "|", "|", "|", "|", "|", "|", "|", "|", 1, true};
+// clang-format on
+
+constexpr const Theme *presets[] = {&ascii, &unicode, &heavy, &doubled, &markdown};
+
+// the preset a theme equals to, or nullptr for a user defined theme
+inline const Theme *find(const Theme &theme)
+{
+    for (auto preset : presets) {
+        if (preset == &theme) {
+            return preset;
+        }
+    }
+    for (auto preset : presets) {
+        if (*preset == theme) {
+            return preset;
+        }
+    }
+    return nullptr;
+}
+} // namespace themes
+
+// display width of a user customised border glyph, glyphs of the presets carry their width in the theme
+static size_t glyph_width_of(const std::string &glyph, bool multi_bytes_character)
+{
+    if (std::all_of(glyph.begin(), glyph.end(), [](char c) {
+            return c >= 0x20 && c < 0x7F;
+        })) {
+        return glyph.size();
+    }
+    return display_width_of(glyph, UnicodePolicy(), multi_bytes_character);
+}
+
+// repeat a glyph of known display width to fill len columns
+static std::string expand_to_size(std::string_view s, size_t swidth, size_t len)
+{
+    if (s.empty()) {
+        return std::string(len, ' ');
     }
     if (len == 0) {
-        return s;
+        return std::string(s);
     }
-    size_t swidth = display_width_of(s, "", multi_bytes_character);
-    for (size_t i = 0; i < len;) {
-        if (swidth > len - i) {
-            r += s.substr(0, len - i);
-        } else {
-            r += s;
+    if (s.size() == 1) {
+        return std::string(len, s[0]);
+    }
+    if (swidth == 0) {
+        return std::string(s);
+    }
+
+    // repeat full glyphs by doubling the copied range, then append the partial tail
+    size_t full = (len / swidth) * s.size(), partial = len % swidth;
+    std::string r;
+    r.reserve(full + partial);
+    if (full > 0) {
+        r.append(s);
+        while (r.size() * 2 <= full) {
+            r.append(r);
         }
-        i += swidth;
+        r.append(r, 0, full - r.size());
+    }
+    if (partial > 0) {
+        r.append(s, 0, partial);
     }
     return r;
 }
@@ -483,6 +868,13 @@ struct Border {
     TrueColor color;
     std::string content;
     TrueColor background_color;
+    Glyph glyph = Glyph::none; // slot in the preset of the format, content is used when none
+
+    bool operator==(const Border &other) const
+    {
+        return visiable == other.visiable && padding == other.padding && color == other.color
+               && glyph == other.glyph && content == other.content && background_color == other.background_color;
+    }
 };
 
 struct Corner {
@@ -490,6 +882,13 @@ struct Corner {
     TrueColor color;
     std::string content;
     TrueColor background_color;
+    Glyph glyph = Glyph::none; // slot in the preset of the format, content is used when none
+
+    bool operator==(const Corner &other) const
+    {
+        return visiable == other.visiable && color == other.color && glyph == other.glyph && content == other.content
+               && background_color == other.background_color;
+    }
 };
 
 class Format {
@@ -497,66 +896,71 @@ class Format {
     Format()
     {
         cell.width = 0;
+        cell.fixed = false;
         cell.height = 0;
         cell.align = Align::left;
         cell.color = Color::none;
         cell.background_color = Color::none;
 
+        // borders and corners refer to the ascii preset, no string is stored unless customised
+        preset = &themes::ascii;
+
         // border-left
         borders.left.visiable = true;
         borders.left.padding = 1;
-        borders.left.content = "|";
+        borders.left.glyph = Glyph::vertical;
         borders.left.color = Color::none;
         borders.left.background_color = Color::none;
 
         // border-right
         borders.right.visiable = true;
         borders.right.padding = 1;
-        borders.right.content = "|";
+        borders.right.glyph = Glyph::vertical;
         borders.right.color = Color::none;
         borders.right.background_color = Color::none;
 
         // border-top
         borders.top.visiable = true;
         borders.top.padding = 0;
-        borders.top.content = "-";
+        borders.top.glyph = Glyph::horizontal;
         borders.top.color = Color::none;
         borders.top.background_color = Color::none;
 
         // border-bottom
         borders.bottom.visiable = true;
         borders.bottom.padding = 0;
-        borders.bottom.content = "-";
+        borders.bottom.glyph = Glyph::horizontal;
         borders.bottom.color = Color::none;
         borders.bottom.background_color = Color::none;
 
         // corner-top_left
         corners.top_left.visiable = true;
-        corners.top_left.content = "+";
+        corners.top_left.glyph = Glyph::top_left;
         corners.top_left.color = Color::none;
         corners.top_left.background_color = Color::none;
 
         // corner-top_right
         corners.top_right.visiable = true;
-        corners.top_right.content = "+";
+        corners.top_right.glyph = Glyph::top_right;
         corners.top_right.color = Color::none;
         corners.top_right.background_color = Color::none;
 
         // corner-bottom_left
         corners.bottom_left.visiable = true;
-        corners.bottom_left.content = "+";
+        corners.bottom_left.glyph = Glyph::bottom_left;
         corners.bottom_left.color = Color::none;
         corners.bottom_left.background_color = Color::none;
 
         // corner-bottom_right
         corners.bottom_right.visiable = true;
-        corners.bottom_right.content = "+";
+        corners.bottom_right.glyph = Glyph::bottom_right;
         corners.bottom_right.color = Color::none;
         corners.bottom_right.background_color = Color::none;
 
         // internationlization
         internationlization.locale = "";
         internationlization.multi_bytes_character = false;
+        internationlization.policy = UnicodePolicy();
     }
 
     size_t width() const
@@ -572,7 +976,8 @@ class Format {
     Format &width(size_t value)
     {
         cell.width = value;
-        return *this;
+        cell.fixed = value != 0;
+        return touched();
     }
 
     Align align() const
@@ -583,7 +988,7 @@ class Format {
     Format &align(Align value)
     {
         cell.align = value;
-        return *this;
+        return touched();
     }
 
     TrueColor color() const
@@ -594,7 +999,7 @@ class Format {
     Format &color(TrueColor value)
     {
         cell.color = value;
-        return *this;
+        return touched();
     }
 
     TrueColor background_color() const
@@ -605,7 +1010,7 @@ class Format {
     Format &background_color(TrueColor value)
     {
         cell.background_color = value;
-        return *this;
+        return touched();
     }
 
     const Styles &styles() const
@@ -616,7 +1021,7 @@ class Format {
     Format &styles(Style value)
     {
         cell.styles.push_back(value);
-        return *this;
+        return touched();
     }
 
     template <typename... Args>
@@ -630,10 +1035,14 @@ class Format {
     Format &border(const std::string &value)
     {
         borders.left.content = value;
+        borders.left.glyph = Glyph::none;
         borders.right.content = value;
+        borders.right.glyph = Glyph::none;
         borders.top.content = value;
+        borders.top.glyph = Glyph::none;
         borders.bottom.content = value;
-        return *this;
+        borders.bottom.glyph = Glyph::none;
+        return touched();
     }
 
     Format &border_padding(size_t value)
@@ -642,7 +1051,7 @@ class Format {
         borders.right.padding = value;
         borders.top.padding = value;
         borders.bottom.padding = value;
-        return *this;
+        return touched();
     }
 
     Format &border_color(TrueColor value)
@@ -651,7 +1060,7 @@ class Format {
         borders.right.color = value;
         borders.top.color = value;
         borders.bottom.color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_background_color(TrueColor value)
@@ -660,103 +1069,107 @@ class Format {
         borders.right.background_color = value;
         borders.top.background_color = value;
         borders.bottom.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_left(const std::string &value)
     {
         borders.left.content = value;
-        return *this;
+        borders.left.glyph = Glyph::none;
+        return touched();
     }
 
     Format &border_left_color(TrueColor value)
     {
         borders.left.color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_left_background_color(TrueColor value)
     {
         borders.left.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_left_padding(size_t value)
     {
         borders.left.padding = value;
-        return *this;
+        return touched();
     }
 
     Format &border_right(const std::string &value)
     {
         borders.right.content = value;
-        return *this;
+        borders.right.glyph = Glyph::none;
+        return touched();
     }
 
     Format &border_right_color(TrueColor value)
     {
         borders.right.color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_right_background_color(TrueColor value)
     {
         borders.right.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_right_padding(size_t value)
     {
         borders.right.padding = value;
-        return *this;
+        return touched();
     }
 
     Format &border_top(const std::string &value)
     {
         borders.top.content = value;
-        return *this;
+        borders.top.glyph = Glyph::none;
+        return touched();
     }
 
     Format &border_top_color(TrueColor value)
     {
         borders.top.color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_top_background_color(TrueColor value)
     {
         borders.top.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_top_padding(size_t value)
     {
         borders.top.padding = value;
-        return *this;
+        return touched();
     }
 
     Format &border_bottom(const std::string &value)
     {
         borders.bottom.content = value;
-        return *this;
+        borders.bottom.glyph = Glyph::none;
+        return touched();
     }
 
     Format &border_bottom_color(TrueColor value)
     {
         borders.bottom.color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_bottom_background_color(TrueColor value)
     {
         borders.bottom.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &border_bottom_padding(size_t value)
     {
         borders.bottom.padding = value;
-        return *this;
+        return touched();
     }
 
     Format &show_border()
@@ -765,7 +1178,7 @@ class Format {
         borders.right.visiable = true;
         borders.top.visiable = true;
         borders.bottom.visiable = true;
-        return *this;
+        return touched();
     }
 
     Format &hide_border()
@@ -774,65 +1187,69 @@ class Format {
         borders.right.visiable = false;
         borders.top.visiable = false;
         borders.bottom.visiable = false;
-        return *this;
+        return touched();
     }
 
     Format &show_border_top()
     {
         borders.top.visiable = true;
-        return *this;
+        return touched();
     }
 
     Format &hide_border_top()
     {
         borders.top.visiable = false;
-        return *this;
+        return touched();
     }
 
     Format &show_border_bottom()
     {
         borders.bottom.visiable = true;
-        return *this;
+        return touched();
     }
 
     Format &hide_border_bottom()
     {
         borders.bottom.visiable = false;
-        return *this;
+        return touched();
     }
 
     Format &show_border_left()
     {
         borders.left.visiable = true;
-        return *this;
+        return touched();
     }
 
     Format &hide_border_left()
     {
         borders.left.visiable = false;
-        return *this;
+        return touched();
     }
 
     Format &show_border_right()
     {
         borders.right.visiable = true;
-        return *this;
+        return touched();
     }
 
     Format &hide_border_right()
     {
         borders.right.visiable = false;
-        return *this;
+        return touched();
     }
 
     /* corners */
     Format &corner(const std::string &value)
     {
         corners.top_left.content = value;
+        corners.top_left.glyph = Glyph::none;
         corners.top_right.content = value;
+        corners.top_right.glyph = Glyph::none;
         corners.bottom_left.content = value;
+        corners.bottom_left.glyph = Glyph::none;
         corners.bottom_right.content = value;
-        return *this;
+        corners.bottom_right.glyph = Glyph::none;
+        return touched();
     }
 
     Format &corner_color(TrueColor value)
@@ -841,7 +1258,7 @@ class Format {
         corners.top_right.color = value;
         corners.bottom_left.color = value;
         corners.bottom_right.color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_background_color(TrueColor value)
@@ -850,79 +1267,130 @@ class Format {
         corners.top_right.background_color = value;
         corners.bottom_left.background_color = value;
         corners.bottom_right.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_top_left(const std::string &value)
     {
         corners.top_left.content = value;
-        return *this;
+        corners.top_left.glyph = Glyph::none;
+        return touched();
     }
 
     Format &corner_top_left_color(TrueColor value)
     {
         corners.top_left.color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_top_left_background_color(TrueColor value)
     {
         corners.top_left.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_top_right(const std::string &value)
     {
         corners.top_right.content = value;
-        return *this;
+        corners.top_right.glyph = Glyph::none;
+        return touched();
     }
 
     Format &corner_top_right_color(TrueColor value)
     {
         corners.top_right.color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_top_right_background_color(TrueColor value)
     {
         corners.top_right.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_bottom_left(const std::string &value)
     {
         corners.bottom_left.content = value;
-        return *this;
+        corners.bottom_left.glyph = Glyph::none;
+        return touched();
     }
 
     Format &corner_bottom_left_color(TrueColor value)
     {
         corners.bottom_left.color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_bottom_left_background_color(TrueColor value)
     {
         corners.bottom_left.background_color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_bottom_right(const std::string &value)
     {
         corners.bottom_right.content = value;
-        return *this;
+        corners.bottom_right.glyph = Glyph::none;
+        return touched();
     }
 
     Format &corner_bottom_right_color(TrueColor value)
     {
         corners.bottom_right.color = value;
-        return *this;
+        return touched();
     }
 
     Format &corner_bottom_right_background_color(TrueColor value)
     {
         corners.bottom_right.background_color = value;
-        return *this;
+        return touched();
+    }
+
+    /* border presets */
+    Format &theme(const Theme &value)
+    {
+        preset = themes::find(value);
+        if (preset) {
+            borders.left.glyph = Glyph::vertical;
+            borders.right.glyph = Glyph::vertical;
+            borders.top.glyph = Glyph::horizontal;
+            borders.bottom.glyph = Glyph::horizontal;
+            corners.top_left.glyph = Glyph::top_left;
+            corners.top_right.glyph = Glyph::top_right;
+            corners.bottom_left.glyph = Glyph::bottom_left;
+            corners.bottom_right.glyph = Glyph::bottom_right;
+            return touched();
+        }
+
+        // user defined themes have no static storage, keep a copy of the glyphs
+        border_left(std::string(value.vertical));
+        border_right(std::string(value.vertical));
+        border_top(std::string(value.horizontal));
+        border_bottom(std::string(value.horizontal));
+        corner_top_left(std::string(value.top_left));
+        corner_top_right(std::string(value.top_right));
+        corner_bottom_left(std::string(value.bottom_left));
+        corner_bottom_right(std::string(value.bottom_right));
+        return touched();
+    }
+
+    /* glyph actually drawn for a border or corner, from the preset unless customised */
+    template <typename Part>
+    std::string_view glyph(const Part &part) const
+    {
+        if (preset && part.glyph != Glyph::none) {
+            return preset->glyph(part.glyph);
+        }
+        return part.content;
+    }
+
+    template <typename Part>
+    size_t glyph_width(const Part &part) const
+    {
+        if (preset && part.glyph != Glyph::none) {
+            return preset->width;
+        }
+        return glyph_width_of(part.content, internationlization.multi_bytes_character);
     }
 
     /* internationlization */
@@ -934,7 +1402,19 @@ class Format {
     Format &locale(const std::string &value)
     {
         internationlization.locale = value;
-        return *this;
+        internationlization.policy = UnicodePolicy::from_locale(value);
+        return touched();
+    }
+
+    const UnicodePolicy &unicode() const
+    {
+        return internationlization.policy;
+    }
+
+    Format &unicode(const UnicodePolicy &value)
+    {
+        internationlization.policy = value;
+        return touched();
     }
 
     bool multi_bytes_character() const
@@ -945,7 +1425,7 @@ class Format {
     Format &multi_bytes_character(bool value)
     {
         internationlization.multi_bytes_character = value;
-        return *this;
+        return touched();
     }
 
   public:
@@ -955,6 +1435,7 @@ class Format {
         TrueColor color, background_color;
 
         size_t width, height;
+        bool fixed; // width set through width(), kept when the table lays its columns out again
     } cell;
 
     // Element Border
@@ -967,14 +1448,39 @@ class Format {
         Corner top_left, top_right, bottom_left, bottom_right;
     } corners;
 
+    // border preset the glyph slots of borders and corners refer to
+    const Theme *preset = nullptr;
+
+    /* bumped whenever any format, cell content or table layout changes: tables drop their cached rule lines then */
+    static uint64_t revision()
+    {
+        return revisions.load(std::memory_order_relaxed);
+    }
+
+    static void touch()
+    {
+        revisions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  private:
+    Format &touched()
+    {
+        touch();
+        return *this;
+    }
+
+    static inline std::atomic<uint64_t> revisions{0};
+
+  public:
     struct {
         std::string content;
         TrueColor color, background_color;
     } column_separator;
 
     struct {
-        std::string locale;
+        std::string locale; // only used to pick a policy, the global locale is never changed
         bool multi_bytes_character;
+        UnicodePolicy policy;
     } internationlization;
 };
 
@@ -990,17 +1496,19 @@ class Cell {
     void set(const std::string &content)
     {
         m_content = content;
+        Format::touch();
     }
 
     template <typename T>
     void set(const T value)
     {
         m_content = to_string(value);
+        Format::touch();
     }
 
     size_t size()
     {
-        return display_width_of(m_content, m_format.locale(), m_format.multi_bytes_character());
+        return display_width_of(m_content, m_format.unicode(), m_format.multi_bytes_character());
     }
 
     Format &format()
@@ -1026,7 +1534,7 @@ class Cell {
 
                 size_t max_width = 0;
                 while (std::getline(ss, line, '\n')) {
-                    max_width = std::max(max_width, display_width_of(line, m_format.locale(), true));
+                    max_width = std::max(max_width, display_width_of(line, m_format.unicode(), true));
                 }
 
                 return max_width;
@@ -1526,6 +2034,14 @@ class BatchFormat {
         return *this;
     }
 
+    inline BatchFormat &theme(const Theme &value)
+    {
+        for (auto &cell : cells) {
+            cell->format().theme(value);
+        }
+        return *this;
+    }
+
     inline BatchFormat &locale(const std::string &value)
     {
         for (auto &cell : cells) {
@@ -1534,6 +2050,14 @@ class BatchFormat {
         return *this;
     }
 
+    inline BatchFormat &unicode(const UnicodePolicy &value)
+    {
+        for (auto &cell : cells) {
+            cell->format().unicode(value);
+        }
+        return *this;
+    }
+
     inline BatchFormat &multi_bytes_character(bool value)
     {
         for (auto &cell : cells) {
@@ -1560,6 +2084,7 @@ class Row {
     void add(const T v)
     {
         cells.push_back(std::shared_ptr<Cell>(new Cell(to_string(v))));
+        Format::touch();
     }
 
     template <typename T, typename... Args>
@@ -1616,9 +2141,131 @@ class Row {
         return cells.size();
     }
 
-    std::vector<std::string> dump(StringFormatter stringformatter, BorderFormatter borderformatter,
-                                  CornerFormatter cornerformatter, bool showtop, bool showbottom) const
+    /* rule lines built for a previous row, reused as long as widths and border formats don't change */
+    struct RuleCache {
+        const Row *top = nullptr, *bottom = nullptr;
+        bool top_visible = false, bottom_visible = false;
+        std::string top_line, bottom_line;
+    };
+
+    /* rule lines of this row kept by the table between renders, built on first use */
+    struct RuleSlots {
+        bool top_built = false, bottom_built = false;
+        bool top_visible = false, bottom_visible = false;
+        std::string top_line, bottom_line;
+    };
+
+    /* build top or bottom rule line of this row, returns false if it's hidden */
+    bool rule(Which which, const StringFormatter &stringformatter, const BorderFormatter &borderformatter,
+              const CornerFormatter &cornerformatter, std::string &line) const
     {
+        bool top = (which == Which::top);
+        if (cells.size() == 0
+            || !(top ? cells[0]->format().borders.top.visiable : cells.back()->format().borders.bottom.visiable)) {
+            return false;
+        }
+
+        line += cornerformatter(top ? Which::top_left : Which::bottom_left, cells[0].get(), nullptr, nullptr, nullptr,
+                                nullptr, stringformatter);
+        for (size_t i = 0; i < cells.size(); i++) {
+            auto cell = cells[i].get();
+            auto left = i > 0 ? cells[i - 1].get() : nullptr;
+            auto right = (i + 1 < cells.size()) ? cells[i + 1].get() : nullptr;
+
+            auto &borders = cell->format().borders;
+            size_t size = borders.left.padding + cell->width() + borders.right.padding;
+            line += borderformatter(which, cell, left, right, nullptr, nullptr, size, stringformatter);
+            line += cornerformatter(top ? Which::top_right : Which::bottom_right, cell, nullptr, nullptr, nullptr,
+                                    nullptr, stringformatter);
+        }
+        return true;
+    }
+
+    /* top or bottom rule line, reused from cache if the cached row has the same rule layout */
+    const std::string *rule(Which which, const StringFormatter &stringformatter, const BorderFormatter &borderformatter,
+                            const CornerFormatter &cornerformatter, RuleCache &cache) const
+    {
+        bool top = (which == Which::top);
+        const Row *&owner = top ? cache.top : cache.bottom;
+        bool &visible = top ? cache.top_visible : cache.bottom_visible;
+        std::string &line = top ? cache.top_line : cache.bottom_line;
+
+        if (owner == nullptr || !same_rule(*owner, which)) {
+            line.clear();
+            visible = rule(which, stringformatter, borderformatter, cornerformatter, line);
+            owner = this;
+        }
+        return visible ? &line : nullptr;
+    }
+
+    /* whether top or bottom rule line of this row is the same as that of another row */
+    bool same_rule(const Row &other, Which which) const
+    {
+        if (this == &other) {
+            return true;
+        }
+        if (cells.size() != other.cells.size()) {
+            return false;
+        }
+
+        bool top = (which == Which::top);
+        for (size_t i = 0; i < cells.size(); i++) {
+            const Format &a = cells[i]->format(), &b = other.cells[i]->format();
+            if (a.borders.left.padding != b.borders.left.padding || a.borders.right.padding != b.borders.right.padding
+                || a.internationlization.multi_bytes_character != b.internationlization.multi_bytes_character
+                || a.preset != b.preset) {
+                return false;
+            }
+            if (top) {
+                if (!(a.borders.top == b.borders.top) || !(a.corners.top_right == b.corners.top_right)
+                    || (i == 0 && !(a.corners.top_left == b.corners.top_left))) {
+                    return false;
+                }
+            } else {
+                if (!(a.borders.bottom == b.borders.bottom) || !(a.corners.bottom_right == b.corners.bottom_right)
+                    || (i == 0 && !(a.corners.bottom_left == b.corners.bottom_left))) {
+                    return false;
+                }
+            }
+            if (cells[i]->width() != other.cells[i]->width()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<std::string> dump(const StringFormatter &stringformatter, const BorderFormatter &borderformatter,
+                                  const CornerFormatter &cornerformatter, bool showtop, bool showbottom,
+                                  RuleCache *cache = nullptr, RuleSlots *slots = nullptr) const
+    {
+        auto add_rule = [&](Which which, std::vector<std::string> &lines) {
+            bool top = (which == Which::top);
+            if (slots != nullptr && (top ? slots->top_built : slots->bottom_built)) {
+                if (top ? slots->top_visible : slots->bottom_visible) {
+                    lines.push_back(top ? slots->top_line : slots->bottom_line);
+                }
+                return;
+            }
+
+            std::string built;
+            const std::string *line = nullptr;
+            if (cache != nullptr) {
+                line = rule(which, stringformatter, borderformatter, cornerformatter, *cache);
+            } else if (rule(which, stringformatter, borderformatter, cornerformatter, built)) {
+                line = &built;
+            }
+            if (slots != nullptr) {
+                (top ? slots->top_built : slots->bottom_built) = true;
+                (top ? slots->top_visible : slots->bottom_visible) = line != nullptr;
+                if (line != nullptr) {
+                    (top ? slots->top_line : slots->bottom_line) = *line;
+                }
+            }
+            if (line != nullptr) {
+                lines.push_back(*line);
+            }
+        };
+
         size_t max_height = 0;
         std::vector<std::vector<std::string>> dumplines;
         for (auto const &cell : cells) {
@@ -1641,7 +2288,7 @@ class Row {
             if (cell->width() == 0) {
                 wrapped.push_back(cell->get());
             } else {
-                wrapped = wrap_lines(cell->get(), cell->width(), cell->format().locale(),
+                wrapped = wrap_lines(cell->get(), cell->width(), cell->format().unicode(),
                                      cell->format().internationlization.multi_bytes_character);
 #ifdef __DEBUG__
                 std::cout << "wrap to " << wrapped.size() << " lines" << std::endl;
@@ -1652,21 +2299,8 @@ class Row {
         }
 
         std::vector<std::string> lines;
-        if (showtop && cells.size() > 0 && cells[0]->format().borders.top.visiable) {
-            std::string line;
-            line +=
-                cornerformatter(Which::top_left, cells[0].get(), nullptr, nullptr, nullptr, nullptr, stringformatter);
-            for (size_t i = 0; i < cells.size(); i++) {
-                auto cell = cells[i].get();
-                auto left = i > 0 ? cells[i - 1].get() : nullptr;
-                auto right = (i + 1 < cells.size()) ? cells[i + 1].get() : nullptr;
-
-                auto &borders = cell->format().borders;
-                size_t size = borders.left.padding + cell->width() + borders.right.padding;
-                line += borderformatter(Which::top, cell, left, right, nullptr, nullptr, size, stringformatter);
-                line += cornerformatter(Which::top_right, cell, nullptr, nullptr, nullptr, nullptr, stringformatter);
-            }
-            lines.push_back(line);
+        if (showtop) {
+            add_rule(Which::top, lines);
         }
 
         // padding lines on top
@@ -1717,8 +2351,8 @@ class Row {
                         stringformatter(std::string(cell->width(), ' '), Color::none, background_color, cell->styles());
                 } else {
                     auto align_line_by = [&](const std::string &str, size_t width, Align align,
-                                             const std::string &locale, bool multi_bytes_character) -> std::string {
-                        size_t linesize = display_width_of(str, locale, multi_bytes_character);
+                                             const UnicodePolicy &policy, bool multi_bytes_character) -> std::string {
+                        size_t linesize = display_width_of(str, policy, multi_bytes_character);
                         if (linesize >= width) {
                             return stringformatter(str, foreground_color, background_color, cell->styles());
                         }
@@ -1740,7 +2374,7 @@ class Row {
                     };
 
                     line += align_line_by(dumplines[j][i - cell_offset], cell->width(), alignment,
-                                          cell->format().locale(), cell->format().multi_bytes_character());
+                                          cell->format().unicode(), cell->format().multi_bytes_character());
                 }
 
                 line += stringformatter(std::string(cell->format().borders.right.padding, ' '), Color::none,
@@ -1772,21 +2406,8 @@ class Row {
             }
         }
 
-        if (showbottom && cells.size() > 0 && cells.back()->format().borders.bottom.visiable) {
-            std::string line;
-            line += cornerformatter(Which::bottom_left, cells[0].get(), nullptr, nullptr, nullptr, nullptr,
-                                    stringformatter);
-            for (size_t i = 0; i < cells.size(); i++) {
-                auto cell = cells[i].get();
-                auto left = i > 0 ? cells[i - 1].get() : nullptr;
-                auto right = (i + 1 < cells.size()) ? cells[i + 1].get() : nullptr;
-
-                auto &borders = cell->format().borders;
-                size_t size = borders.left.padding + cell->width() + borders.right.padding;
-                line += borderformatter(Which::bottom, cell, left, right, nullptr, nullptr, size, stringformatter);
-                line += cornerformatter(Which::bottom_right, cell, nullptr, nullptr, nullptr, nullptr, stringformatter);
-            }
-            lines.push_back(line);
+        if (showbottom) {
+            add_rule(Which::bottom, lines);
         }
 
         return lines;
@@ -1992,19 +2613,19 @@ static std::string stringformatter(const std::string &str, TrueColor foreground_
 }
 
 std::string borderformatter(Which which, const Cell *self, const Cell *left, const Cell *right, const Cell *top,
-                            const Cell *bottom, size_t expected_size, StringFormatter stringformatter)
+                            const Cell *bottom, size_t expected_size, const StringFormatter &stringformatter)
 {
-#define TRY_GET(pattern, which, which_reverse)                                                                   \
-    if (self->format().pattern.which.visiable) {                                                                 \
-        auto it = self->format().pattern.which;                                                                  \
-        return stringformatter(                                                                                  \
-            expand_to_size(it.content, expected_size, self->format().internationlization.multi_bytes_character), \
-            it.color, it.background_color, {});                                                                  \
-    } else if (which && which->format().pattern.which_reverse.visiable) {                                        \
-        auto it = which->format().pattern.which_reverse;                                                         \
-        return stringformatter(                                                                                  \
-            expand_to_size(it.content, expected_size, self->format().internationlization.multi_bytes_character), \
-            it.color, it.background_color, {});                                                                  \
+#define TRY_GET(pattern, which, which_reverse)                                                                  \
+    if (self->format().pattern.which.visiable) {                                                                \
+        const auto &format = self->format();                                                                    \
+        const auto &it = format.pattern.which;                                                                  \
+        return stringformatter(expand_to_size(format.glyph(it), format.glyph_width(it), expected_size), it.color, \
+                               it.background_color, {});                                                        \
+    } else if (which && which->format().pattern.which_reverse.visiable) {                                       \
+        const auto &format = which->format();                                                                   \
+        const auto &it = format.pattern.which_reverse;                                                          \
+        return stringformatter(expand_to_size(format.glyph(it), format.glyph_width(it), expected_size), it.color, \
+                               it.background_color, {});                                                        \
     }
     if (which == Which::top) {
         TRY_GET(borders, top, bottom);
@@ -2020,15 +2641,15 @@ std::string borderformatter(Which which, const Cell *self, const Cell *left, con
 }
 
 std::string cornerformatter(Which which, const Cell *self, const Cell *top_left, const Cell *top_right,
-                            const Cell *bottom_left, const Cell *bottom_right, StringFormatter stringformatter)
+                            const Cell *bottom_left, const Cell *bottom_right, const StringFormatter &stringformatter)
 {
-#define TRY_GET(pattern, which, which_reverse)                                 \
-    if (self->format().pattern.which.visiable) {                               \
-        auto it = self->format().pattern.which;                                \
-        return stringformatter(it.content, it.color, it.background_color, {}); \
-    } else if (which && which->format().pattern.which_reverse.visiable) {      \
-        auto it = which->format().pattern.which_reverse;                       \
-        return stringformatter(it.content, it.color, it.background_color, {}); \
+#define TRY_GET(pattern, which, which_reverse)                                                          \
+    if (self->format().pattern.which.visiable) {                                                        \
+        const auto &it = self->format().pattern.which;                                                  \
+        return stringformatter(std::string(self->format().glyph(it)), it.color, it.background_color, {}); \
+    } else if (which && which->format().pattern.which_reverse.visiable) {                               \
+        const auto &it = which->format().pattern.which_reverse;                                         \
+        return stringformatter(std::string(which->format().glyph(it)), it.color, it.background_color, {}); \
     }
     if (which == Which::top_left) {
         TRY_GET(corners, top_left, bottom_right);
@@ -2045,6 +2666,406 @@ std::string cornerformatter(Which which, const Cell *self, const Cell *top_left,
 } // namespace xterm
 } // namespace tabulate
 
+/**
+ * Binary snapshot of a table, which can be opened via mmap and read without copying cell contents.
+ *
+ * Layout (native byte order, every section aligned to 8 bytes):
+ *
+ *   +--------+-------+-----------------------------+-------------------------------+-------------------------+
+ *   | header | title | formats: {offset, size}[n]  | columns: SnapshotColumn[cols] | per column:             |
+ *   |        |       |          + encoded formats  |                               | offsets[rows + 1]       |
+ *   |        |       |                             |                               | format indices[rows]    |
+ *   |        |       |                             |                               | content blob            |
+ *   +--------+-------+-----------------------------+-------------------------------+-------------------------+
+ *
+ * Formats are interned, every cell refers to one of them by index, and a missing cell(ragged row) is recorded
+ * with index `SNAPSHOT_ABSENT`.
+ *
+ * Opening decodes the interned formats only, cells are read in place through the accessors of Snapshot, which is
+ * the zero-copy path. Table::load() copies every cell into a table instead, with a few allocations per cell.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint64_t rows, columns, width;
+    uint64_t title_offset, title_size;
+    uint64_t formats_offset, formats_count;
+    uint64_t columns_offset;
+};
+
+struct SnapshotColumn {
+    uint64_t width;
+    uint64_t offsets;
+    uint64_t formats;
+    uint64_t blob, blob_size;
+};
+
+static const char SNAPSHOT_MAGIC[8] = {'T', 'A', 'B', 'U', 'L', 'A', 'T', 'E'};
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const uint32_t SNAPSHOT_BYTEORDER = 0x01020304;
+static const uint32_t SNAPSHOT_ABSENT = 0xFFFFFFFF;
+
+class Snapshot {
+  public:
+    Snapshot() : data(nullptr), length(0), mapped(false), header() {}
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+    ~Snapshot()
+    {
+        close();
+    }
+
+    /* returns 0 on success, or a negative value if the file can't be read or is not a valid snapshot */
+    int open(const std::string &path)
+    {
+        close();
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return -errno;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            return -err;
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                length = 0;
+                return -err;
+            }
+            data = static_cast<const char *>(addr);
+            mapped = true;
+        }
+        ::close(fd);
+#else
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs) {
+            return -1;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+#endif
+        if (!__parse()) {
+            close();
+            return -1;
+        }
+
+        return 0;
+    }
+
+    void close()
+    {
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+        if (mapped) {
+            munmap(const_cast<char *>(data), length);
+        }
+#endif
+        buffer.clear();
+        formats.clear();
+        data = nullptr;
+        length = 0;
+        mapped = false;
+        header = SnapshotHeader();
+    }
+
+    bool is_open() const
+    {
+        return data != nullptr;
+    }
+
+    size_t rows() const
+    {
+        return header.rows;
+    }
+
+    size_t columns() const
+    {
+        return header.columns;
+    }
+
+    size_t width() const
+    {
+        return header.width;
+    }
+
+    size_t width(size_t column) const
+    {
+        if (column >= header.columns) {
+            return 0;
+        }
+        return __column(column).width;
+    }
+
+    std::string_view title() const
+    {
+        return std::string_view(data + header.title_offset, header.title_size);
+    }
+
+    bool has(size_t row, size_t column) const
+    {
+        return __format_index(row, column) != SNAPSHOT_ABSENT;
+    }
+
+    /* zero-copy view of cell content, valid as long as the snapshot is open */
+    std::string_view get(size_t row, size_t column) const
+    {
+        if (row >= header.rows || column >= header.columns) {
+            return std::string_view();
+        }
+        auto col = __column(column);
+        uint64_t begin = __load<uint64_t>(col.offsets + row * sizeof(uint64_t));
+        uint64_t end = __load<uint64_t>(col.offsets + (row + 1) * sizeof(uint64_t));
+        if (begin > end || end > col.blob_size) {
+            return std::string_view();
+        }
+        return std::string_view(data + col.blob + begin, end - begin);
+    }
+
+    const Format &format(size_t row, size_t column) const
+    {
+        uint32_t index = __format_index(row, column);
+        return index < formats.size() ? formats[index] : default_format;
+    }
+
+    /* append a binary representation of format to output, which is also used as the key for interning */
+    static void encode(std::string &output, const Format &format)
+    {
+        auto put = [&output](auto value) {
+            output.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        auto put_string = [&](std::string_view value) {
+            put(static_cast<uint32_t>(value.size()));
+            output.append(value);
+        };
+        auto put_color = [&](const TrueColor &value) {
+            put(static_cast<int32_t>(value.hex));
+            put(static_cast<int32_t>(value.color));
+        };
+        auto put_border = [&](const Border &border) {
+            put(static_cast<uint8_t>(border.visiable));
+            put(static_cast<uint64_t>(border.padding));
+            put_color(border.color);
+            put_string(format.glyph(border));
+            put_color(border.background_color);
+        };
+        auto put_corner = [&](const Corner &corner) {
+            put(static_cast<uint8_t>(corner.visiable));
+            put_color(corner.color);
+            put_string(format.glyph(corner));
+            put_color(corner.background_color);
+        };
+
+        put(static_cast<int32_t>(format.cell.align));
+        put(static_cast<uint32_t>(format.cell.styles.size()));
+        for (auto const &style : format.cell.styles) {
+            put(static_cast<int32_t>(style));
+        }
+        put_color(format.cell.color);
+        put_color(format.cell.background_color);
+        put(static_cast<uint64_t>(format.cell.width));
+        put(static_cast<uint64_t>(format.cell.height));
+
+        put_border(format.borders.left);
+        put_border(format.borders.right);
+        put_border(format.borders.top);
+        put_border(format.borders.bottom);
+
+        put_corner(format.corners.top_left);
+        put_corner(format.corners.top_right);
+        put_corner(format.corners.bottom_left);
+        put_corner(format.corners.bottom_right);
+
+        put_string(format.column_separator.content);
+        put_color(format.column_separator.color);
+        put_color(format.column_separator.background_color);
+
+        put_string(format.internationlization.locale);
+        put(static_cast<uint8_t>(format.internationlization.multi_bytes_character));
+        put(static_cast<uint8_t>(format.internationlization.policy.ambiguous_width));
+        put(static_cast<uint8_t>(format.internationlization.policy.emoji_width));
+    }
+
+    /* decode a format encoded by `encode`, returns false if input is truncated */
+    static bool decode(const char *&input, const char *end, Format &format)
+    {
+        bool ok = true;
+        auto get = [&](auto &value) {
+            if (ok && static_cast<size_t>(end - input) >= sizeof(value)) {
+                memcpy(&value, input, sizeof(value));
+                input += sizeof(value);
+            } else {
+                ok = false;
+            }
+        };
+        auto get_string = [&](std::string &value) {
+            uint32_t size = 0;
+            get(size);
+            if (ok && static_cast<size_t>(end - input) >= size) {
+                value.assign(input, size);
+                input += size;
+            } else {
+                ok = false;
+            }
+        };
+        auto get_color = [&](TrueColor &value) {
+            int32_t hex = 0, color = 0;
+            get(hex);
+            get(color);
+            value.hex = hex;
+            value.color = static_cast<Color>(color);
+        };
+        auto get_bool = [&](bool &value) {
+            uint8_t v = 0;
+            get(v);
+            value = v != 0;
+        };
+        auto get_size = [&](size_t &value) {
+            uint64_t v = 0;
+            get(v);
+            value = static_cast<size_t>(v);
+        };
+        auto get_border = [&](Border &border) {
+            get_bool(border.visiable);
+            get_size(border.padding);
+            get_color(border.color);
+            get_string(border.content);
+            border.glyph = Glyph::none;
+            get_color(border.background_color);
+        };
+        auto get_corner = [&](Corner &corner) {
+            get_bool(corner.visiable);
+            get_color(corner.color);
+            get_string(corner.content);
+            corner.glyph = Glyph::none;
+            get_color(corner.background_color);
+        };
+
+        int32_t align = 0;
+        get(align);
+        format.cell.align = static_cast<Align>(align);
+        uint32_t nstyles = 0;
+        get(nstyles);
+        format.cell.styles.clear();
+        for (uint32_t i = 0; ok && i < nstyles; i++) {
+            int32_t style = 0;
+            get(style);
+            format.cell.styles.push_back(static_cast<Style>(style));
+        }
+        get_color(format.cell.color);
+        get_color(format.cell.background_color);
+        get_size(format.cell.width);
+        get_size(format.cell.height);
+
+        get_border(format.borders.left);
+        get_border(format.borders.right);
+        get_border(format.borders.top);
+        get_border(format.borders.bottom);
+
+        get_corner(format.corners.top_left);
+        get_corner(format.corners.top_right);
+        get_corner(format.corners.bottom_left);
+        get_corner(format.corners.bottom_right);
+
+        get_string(format.column_separator.content);
+        get_color(format.column_separator.color);
+        get_color(format.column_separator.background_color);
+
+        get_string(format.internationlization.locale);
+        get_bool(format.internationlization.multi_bytes_character);
+        uint8_t ambiguous_width = 1, emoji_width = 2;
+        get(ambiguous_width);
+        get(emoji_width);
+        format.internationlization.policy = UnicodePolicy(ambiguous_width, emoji_width);
+
+        return ok;
+    }
+
+  private:
+    const char *data;
+    size_t length;
+    bool mapped;
+    std::string buffer; // used if mmap is unavailable
+    SnapshotHeader header;
+    std::vector<Format> formats;
+    Format default_format;
+
+    template <typename T>
+    T __load(uint64_t offset) const
+    {
+        T value;
+        memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    SnapshotColumn __column(size_t column) const
+    {
+        return __load<SnapshotColumn>(header.columns_offset + column * sizeof(SnapshotColumn));
+    }
+
+    uint32_t __format_index(size_t row, size_t column) const
+    {
+        if (row >= header.rows || column >= header.columns) {
+            return SNAPSHOT_ABSENT;
+        }
+        return __load<uint32_t>(__column(column).formats + row * sizeof(uint32_t));
+    }
+
+    bool __within(uint64_t offset, uint64_t size) const
+    {
+        return offset <= length && size <= length - offset;
+    }
+
+    bool __parse()
+    {
+        if (length < sizeof(SnapshotHeader)) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION
+            || header.byteorder != SNAPSHOT_BYTEORDER) {
+            return false;
+        }
+        if (!__within(header.title_offset, header.title_size)
+            || header.formats_count > length / (2 * sizeof(uint64_t))
+            || !__within(header.formats_offset, header.formats_count * 2 * sizeof(uint64_t))
+            || header.columns > length / sizeof(SnapshotColumn)
+            || !__within(header.columns_offset, header.columns * sizeof(SnapshotColumn))) {
+            return false;
+        }
+
+        formats.resize(header.formats_count);
+        for (uint64_t i = 0; i < header.formats_count; i++) {
+            uint64_t offset = __load<uint64_t>(header.formats_offset + i * 2 * sizeof(uint64_t));
+            uint64_t size = __load<uint64_t>(header.formats_offset + (i * 2 + 1) * sizeof(uint64_t));
+            if (!__within(offset, size)) {
+                return false;
+            }
+            const char *input = data + offset;
+            if (!decode(input, input + size, formats[i])) {
+                return false;
+            }
+        }
+
+        for (uint64_t i = 0; i < header.columns; i++) {
+            auto col = __column(i);
+            if (header.rows >= length / sizeof(uint64_t) || !__within(col.offsets, (header.rows + 1) * sizeof(uint64_t))
+                || !__within(col.formats, header.rows * sizeof(uint32_t)) || !__within(col.blob, col.blob_size)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
 class Table : public std::enable_shared_from_this<Table> {
   public:
     Table() {}
@@ -2060,6 +3081,23 @@ class Table : public std::enable_shared_from_this<Table> {
         this->title = std::move(title);
     }
 
+    /* apply a border preset to the whole table, junctions are chosen by the position of each cell */
+    Table &theme(const Theme &value)
+    {
+        preset = value;
+        __apply_theme(0);
+        return *this;
+    }
+
+    /* width policy of multi-byte characters for all cells, including rows added later */
+    Table &unicode(const UnicodePolicy &value)
+    {
+        policy = value;
+        format().unicode(value);
+        __update_widths();
+        return *this;
+    }
+
     BatchFormat format()
     {
         return BatchFormat(cells);
@@ -2204,11 +3242,17 @@ class Table : public std::enable_shared_from_this<Table> {
             }
         };
 
+        // separator lines are built once per layout and kept by the table between renders
+        Row::RuleCache rules;
+        std::lock_guard<std::mutex> guard(rule_lines.lock);
+        std::vector<Row::RuleSlots> &slots = rule_lines.of(rows.size(), !disable_color);
+
         // add header
         if (rows.size() > 0) {
             const auto &header = *rows[0];
-            for (auto line : header.dump(stringformatter, tabulate::xterm::borderformatter,
-                                         tabulate::xterm::cornerformatter, true, rows.size() == 1)) {
+            for (auto const &line :
+                 header.dump(stringformatter, tabulate::xterm::borderformatter, tabulate::xterm::cornerformatter, true,
+                             rows.size() == 1, &rules, &slots[0])) {
                 exported += line + NEWLINE;
             }
         }
@@ -2216,8 +3260,9 @@ class Table : public std::enable_shared_from_this<Table> {
         // add table content
         for (size_t i = 1; i < rows.size(); i++) {
             auto const &row = *rows[i];
-            for (auto const &line : row.dump(stringformatter, tabulate::xterm::borderformatter,
-                                             tabulate::xterm::cornerformatter, true, i == rows.size() - 1)) {
+            for (auto const &line :
+                 row.dump(stringformatter, tabulate::xterm::borderformatter, tabulate::xterm::cornerformatter, true,
+                          i == rows.size() - 1, &rules, &slots[i])) {
                 exported += line + NEWLINE;
             }
         }
@@ -2244,13 +3289,18 @@ class Table : public std::enable_shared_from_this<Table> {
             }
         }
 
+        Row::RuleCache rules;
+        std::lock_guard<std::mutex> guard(rule_lines.lock);
+        std::vector<Row::RuleSlots> &slots = rule_lines.of(rows.size(), true);
+
         // add header
         size_t hlines = 0;
         std::string header;
         if (rows.size() > 0) {
             const auto &_header = *rows[0];
-            for (auto const &line : _header.dump(tabulate::xterm::stringformatter, tabulate::xterm::borderformatter,
-                                                 tabulate::xterm::cornerformatter, true, rows.size() == 1)) {
+            for (auto const &line :
+                 _header.dump(tabulate::xterm::stringformatter, tabulate::xterm::borderformatter,
+                              tabulate::xterm::cornerformatter, true, rows.size() == 1, &rules, &slots[0])) {
                 hlines++;
                 header += line + NEWLINE;
             }
@@ -2264,7 +3314,7 @@ class Table : public std::enable_shared_from_this<Table> {
         for (size_t i = 1; i < rows.size(); i++) {
             auto const &row = *rows[i];
             auto lines = row.dump(tabulate::xterm::stringformatter, tabulate::xterm::borderformatter,
-                                  tabulate::xterm::cornerformatter, true, i == rows.size() - 1);
+                                  tabulate::xterm::cornerformatter, true, i == rows.size() - 1, &rules, &slots[i]);
 
             if (keep_row_in_one_page) {
                 size_t rowlines = lines.size();
@@ -2454,13 +3504,239 @@ class Table : public std::enable_shared_from_this<Table> {
         return exported;
     }
 
+    /* save table as a binary snapshot(see `Snapshot`), returns 0 on success or a negative value on failure */
+    int save(const std::string &path) const
+    {
+        const size_t nrows = rows.size(), ncols = column_size();
+
+        std::string output(sizeof(SnapshotHeader), '\0');
+        auto align = [&output]() {
+            output.resize((output.size() + 7) & ~static_cast<size_t>(7), '\0');
+        };
+        auto put = [&output](size_t offset, auto value) {
+            memcpy(&output[offset], &value, sizeof(value));
+        };
+
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byteorder = SNAPSHOT_BYTEORDER;
+        header.rows = nrows;
+        header.columns = ncols;
+        header.width = cached_width;
+
+        header.title_offset = output.size();
+        header.title_size = title.size();
+        output += title;
+        align();
+
+        // intern formats, cells sharing the same format refer to the same entry
+        std::string key;
+        std::vector<std::string> encoded;
+        std::unordered_map<std::string, uint32_t> interned;
+        std::vector<std::vector<uint32_t>> indices(ncols, std::vector<uint32_t>(nrows, SNAPSHOT_ABSENT));
+        for (size_t r = 0; r < nrows; r++) {
+            auto const &row = *rows[r];
+            for (size_t c = 0; c < row.size(); c++) {
+                key.clear();
+                Snapshot::encode(key, row[c].format());
+                auto it = interned.find(key);
+                if (it == interned.end()) {
+                    it = interned.emplace(key, static_cast<uint32_t>(encoded.size())).first;
+                    encoded.push_back(key);
+                }
+                indices[c][r] = it->second;
+            }
+        }
+
+        header.formats_offset = output.size();
+        header.formats_count = encoded.size();
+        output.resize(output.size() + encoded.size() * 2 * sizeof(uint64_t));
+        for (size_t i = 0; i < encoded.size(); i++) {
+            put(header.formats_offset + i * 2 * sizeof(uint64_t), static_cast<uint64_t>(output.size()));
+            put(header.formats_offset + (i * 2 + 1) * sizeof(uint64_t), static_cast<uint64_t>(encoded[i].size()));
+            output += encoded[i];
+            align();
+        }
+
+        // columnar content: offsets, format indices and a blob of concatenated contents for each column
+        header.columns_offset = output.size();
+        output.resize(output.size() + ncols * sizeof(SnapshotColumn));
+        for (size_t c = 0; c < ncols; c++) {
+            SnapshotColumn column;
+            column.width = 0;
+            for (size_t r = 0; r < nrows; r++) {
+                if (c < rows[r]->size()) {
+                    column.width = (*rows[r])[c].width();
+                    break;
+                }
+            }
+
+            column.offsets = output.size();
+            output.resize(output.size() + (nrows + 1) * sizeof(uint64_t));
+            uint64_t offset = 0;
+            for (size_t r = 0; r < nrows; r++) {
+                put(column.offsets + r * sizeof(uint64_t), offset);
+                if (c < rows[r]->size()) {
+                    offset += (*rows[r])[c].get().size();
+                }
+            }
+            put(column.offsets + nrows * sizeof(uint64_t), offset);
+
+            column.formats = output.size();
+            output.resize(output.size() + nrows * sizeof(uint32_t));
+            memcpy(&output[column.formats], indices[c].data(), nrows * sizeof(uint32_t));
+            align();
+
+            column.blob = output.size();
+            column.blob_size = offset;
+            output.reserve(output.size() + offset);
+            for (size_t r = 0; r < nrows; r++) {
+                if (c < rows[r]->size()) {
+                    output += (*rows[r])[c].get();
+                }
+            }
+            align();
+
+            put(header.columns_offset + c * sizeof(SnapshotColumn), column);
+        }
+        put(0, header);
+
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            return -1;
+        }
+        ofs.write(output.data(), static_cast<std::streamsize>(output.size()));
+
+        return ofs.good() ? 0 : -1;
+    }
+
+    /* replace content of table with a binary snapshot, returns 0 on success or a negative value on failure. Every
+     * cell is copied with its own Format, read large snapshots through Snapshot to avoid that */
+    int load(const std::string &path)
+    {
+        Snapshot snapshot;
+        int ret = snapshot.open(path);
+        if (ret != 0) {
+            return ret;
+        }
+        load(snapshot);
+
+        return 0;
+    }
+
+    void load(const Snapshot &snapshot)
+    {
+        title = std::string(snapshot.title());
+        rows.clear();
+        cells.clear();
+        merges.clear();
+
+        // formats come from the snapshot as they are, the previous theme and policy must not touch added rows
+        preset.reset();
+        themed_columns = 0;
+        policy.reset();
+
+        rows.reserve(snapshot.rows());
+        cells.reserve(snapshot.rows() * snapshot.columns());
+        for (size_t r = 0; r < snapshot.rows(); r++) {
+            auto row = std::make_shared<Row>();
+            for (size_t c = 0; c < snapshot.columns() && snapshot.has(r, c); c++) {
+                row->add(std::string(snapshot.get(r, c)));
+                row->cell(c)->format() = snapshot.format(r, c);
+                cells.push_back(row->cell(c));
+            }
+            rows.push_back(row);
+        }
+        // widths are restored from snapshot, no need to go through __on_add_auto_update row by row
+        cached_width = snapshot.width();
+        Format::touch();
+    }
+
   private:
     std::string title;
     std::vector<std::shared_ptr<Row>> rows;
     std::vector<std::shared_ptr<Cell>> cells; // for batch format
     std::vector<std::tuple<int, int, int, int>> merges;
 
-    size_t cached_width;
+    size_t cached_width = 0;
+
+    std::optional<Theme> preset;
+    size_t themed_columns = 0;
+    std::optional<UnicodePolicy> policy;
+
+    /* rule lines of every row kept between xterm() calls, with and without colors, until Format::revision() moves.
+     * A copied table starts without them */
+    struct RuleLines {
+        std::mutex lock;
+        uint64_t revision = 0;
+        std::vector<Row::RuleSlots> rows[2];
+
+        RuleLines() = default;
+        RuleLines(const RuleLines &) {}
+        RuleLines &operator=(const RuleLines &)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            rows[0].clear();
+            rows[1].clear();
+            return *this;
+        }
+
+        std::vector<Row::RuleSlots> &of(size_t count, bool colored)
+        {
+            uint64_t now = Format::revision();
+            if (revision != now) {
+                rows[0].clear();
+                rows[1].clear();
+                revision = now;
+            }
+            std::vector<Row::RuleSlots> &slots = rows[colored];
+            if (slots.size() != count) {
+                slots.assign(count, Row::RuleSlots());
+            }
+            return slots;
+        }
+    };
+    mutable RuleLines rule_lines;
+
+    void __apply_theme(size_t from)
+    {
+        const Theme *known = themes::find(*preset);
+        const Theme &theme = known ? *known : *preset;
+
+        // junctions of a preset are slots in its glyph table, only user defined themes copy the glyph
+        auto junction = [&](Corner &corner, Glyph glyph) {
+            if (known) {
+                corner.glyph = glyph;
+            } else {
+                corner.content = theme.glyph(glyph);
+            }
+        };
+
+        for (size_t r = from; r < rows.size(); r++) {
+            auto &row = *rows[r];
+            for (size_t c = 0; c < row.size(); c++) {
+                auto &format = row[c].format();
+                bool last = (c + 1 == row.size());
+
+                format.theme(theme);
+                junction(format.corners.top_left, r == 0 ? Glyph::top_left : Glyph::mid_left);
+                if (r == 0) {
+                    junction(format.corners.top_right, last ? Glyph::top_right : Glyph::top_mid);
+                } else {
+                    junction(format.corners.top_right, last ? Glyph::mid_right : Glyph::mid_mid);
+                }
+                junction(format.corners.bottom_right, last ? Glyph::bottom_right : Glyph::bottom_mid);
+                if (theme.header_only) {
+                    format.borders.top.visiable = (r == 1);
+                    format.borders.bottom.visiable = false;
+                }
+            }
+        }
+        themed_columns = column_size();
+        Format::touch();
+    }
 
     Row &__add_row()
     {
@@ -2469,8 +3745,46 @@ class Table : public std::enable_shared_from_this<Table> {
         return *row;
     }
 
+    /* size every column to its widest cell again, e.g. after the width policy changed */
+    /* lay columns out again: a column with a width set by the user keeps it, the others fit their widest cell */
+    void __update_widths()
+    {
+        size_t headerwidth = 0;
+        for (size_t i = 0; i < column_size(); i++) {
+            Column col = column(i);
+            size_t fixed = 0, natural = 0;
+            for (size_t r = 0; r < col.size(); r++) {
+                auto &format = col[r].format();
+                if (format.cell.fixed) {
+                    fixed = std::max(fixed, format.cell.width);
+                } else {
+                    format.cell.width = 0;
+                    natural = std::max(natural, col[r].width());
+                }
+            }
+            size_t width = fixed != 0 ? fixed : natural;
+            for (size_t r = 0; r < col.size(); r++) {
+                auto &format = col[r].format();
+                if (!format.cell.fixed) {
+                    format.cell.width = width;
+                }
+            }
+            headerwidth += width;
+        }
+        cached_width = headerwidth;
+        Format::touch();
+    }
+
     void __on_add_auto_update()
     {
+        // the policy decides how wide the new cells are, so it goes first
+        Row &last_row = *rows[rows.size() - 1];
+        if (policy) {
+            for (size_t i = 0; i < last_row.size(); i++) {
+                last_row[i].format().unicode(*policy);
+            }
+        }
+
         // auto update width
         size_t headerwidth = 0;
         for (size_t i = 0; i < column_size(); i++) {
@@ -2480,24 +3794,32 @@ class Table : public std::enable_shared_from_this<Table> {
             size_t newwidth = col[col.size() - 1].width();
 
             if (newwidth != oldwidth) {
+                // layout widths, not set by the user: keep the fixed flags as they are
                 if (newwidth > oldwidth) {
                     headerwidth += newwidth;
-                    col.format().width(newwidth);
+                    for (size_t r = 0; r < col.size(); r++) {
+                        col[r].format().cell.width = newwidth;
+                    }
                 } else {
                     headerwidth += oldwidth;
-                    col[col.size() - 1].format().width(oldwidth);
+                    col[col.size() - 1].format().cell.width = oldwidth;
                 }
             } else {
                 headerwidth += oldwidth;
             }
         }
         cached_width = headerwidth;
+        Format::touch();
 
         // append new cells
-        Row &last_row = *rows[rows.size() - 1];
         for (size_t i = 0; i < last_row.size(); i++) {
             cells.push_back(last_row.cell(i));
         }
+
+        // junctions of previous rows change only if the number of columns changes
+        if (preset) {
+            __apply_theme(column_size() != themed_columns ? 0 : rows.size() - 1);
+        }
     }
 
     size_t __width()
@@ -2506,13 +3828,11 @@ class Table : public std::enable_shared_from_this<Table> {
         for (auto const &cell : *rows[0]) {
             auto &format = cell.format();
             if (format.borders.left.visiable) {
-                size += display_width_of(format.borders.left.content, format.locale(),
-                                         format.internationlization.multi_bytes_character);
+                size += format.glyph_width(format.borders.left);
             }
             size += format.borders.left.padding + cell.width() + format.borders.right.padding;
             if (format.borders.right.visiable) {
-                size += display_width_of(format.borders.right.content, format.locale(),
-                                         format.internationlization.multi_bytes_character);
+                size += format.glyph_width(format.borders.right);
             }
         }
         return size;
@@ -16,19 +16,46 @@
 
 #pragma once
 
+#include <algorithm>          // std::min
 #include <atomic>             // std::atomic
 #include <chrono>             // std::chrono
+#include <cerrno>             // errno, ETIMEDOUT
+#include <climits>            // INT_MAX
+#include <cstddef>            // std::max_align_t
 #include <cstdint>            // std::int_fast64_t, std::uint_fast32_t
-#include <functional>         // std::function
-#include <future>             // std::future, std::promise
+#include <cstdio>             // snprintf
+#include <deque>              // std::deque
+#include <exception>          // std::exception, std::exception_ptr
+#include <fstream>            // std::ifstream
+#include <functional>         // std::invoke, std::plus, std::less
+#include <initializer_list>   // std::initializer_list
+#include <iterator>           // std::distance, std::iterator_traits
+#include <new>                // placement new
+#include <future>             // std::future_error, std::future_status
+#include <optional>           // std::optional
 #include <memory>             // std::shared_ptr, std::unique_ptr
 #include <mutex>              // std::mutex, std::lock_guard
 #include <queue>              // std::queue
+#include <stdexcept>          // std::logic_error
+#include <string>             // std::string
 #include <thread>             // std::this_thread, std::thread
 #include <type_traits>        // std::decay_t, std::enable_if_t, std::is_void_v, std::invoke_result_t
 #include <utility>            // std::move, std::swap
+#include <vector>             // std::vector
 #include <condition_variable> // std::condition_variable
 #include <iostream>
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine> // std::coroutine_handle, std::suspend_always
+#define THREADPOOL_COROUTINES 1
+#endif
+#if defined(__linux__)
+#include <linux/futex.h> // FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <pthread.h>     // pthread_setaffinity_np
+#include <sched.h>       // cpu_set_t, sched_getcpu
+#include <time.h>        // timespec
+#include <sys/syscall.h> // SYS_futex
+#include <unistd.h>      // syscall
+#endif
 
 #ifndef THREADPOOL_TRACE
 #define THREADPOOL_TRACE(...)
@@ -50,344 +77,2170 @@ namespace multiprocessing
  *
  * I would recommend the conditional approach, and if the reaction time is too slow, switch to yield.
  *
+ * if you push many fine-grained tasks, or tasks that push further tasks, use work stealing: every worker owns a deque,
+ * tasks pushed from a worker go to its own deque and are popped LIFO, idle workers steal from a random victim, and
+ * only tasks pushed from outside the pool go through the shared queue.
+ *
+ * lock free keeps a single FIFO queue but replaces the mutex with a bounded MPMC ring, idle workers park on a futex
+ * (std::atomic::wait in C++20) instead of a condition variable. when the ring is full, push() runs the task on the
+ * calling thread.
  */
 enum {
     CONDITION_VARIABLE,
     YIELD_OR_SCHED_DURATION,
+    WORK_STEALING,
+    LOCK_FREE,
 };
 
-template <int strategy = CONDITION_VARIABLE>
-class threadpool {
-  public:
-    using size_type = unsigned int;
-    threadpool(size_type concurrency = std::thread::hardware_concurrency())
-        : paused(false),
-          stopped(false),
-          duration(10),
-          concurrency(concurrency),
-          workers(new std::thread[concurrency]),
-          unfinished_task_size(0)
-    {
-        for (size_type i = 0; i < concurrency; i++) {
-            workers[i] = std::thread(&threadpool::__worker, this);
+#if !defined(__linux__)
+/* without a futex, a timed park waits on the bucket its word hashes to, which atomic_unpark() notifies */
+struct park_bucket {
+    std::mutex lock;
+    std::condition_variable cond;
+};
+
+inline park_bucket &park_bucket_of(const void *word)
+{
+    static park_bucket buckets[64];
+    return buckets[(reinterpret_cast<uintptr_t>(word) / sizeof(uint32_t)) % 64];
+}
+#endif
+
+/**
+ * @brief Block while word still holds expected, until atomic_unpark() is called on it. Spurious returns are possible.
+ * On Linux every park is a raw futex wait, whatever the language version, so that untimed and timed parks on the
+ * same word are never mixed with std::atomic::wait.
+ */
+inline void atomic_park(std::atomic<uint32_t> &word, uint32_t expected)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif __cplusplus >= 202002L
+    word.wait(expected);
+#else
+    park_bucket &bucket = park_bucket_of(&word);
+    std::unique_lock<std::mutex> lock(bucket.lock);
+    bucket.cond.wait(lock, [&] {
+        return word.load() != expected;
+    });
+#endif
+}
+
+/**
+ * @brief atomic_park() for at most timeout, returns false if it timed out with word still holding expected.
+ */
+inline bool atomic_park_for(std::atomic<uint32_t> &word, uint32_t expected, std::chrono::nanoseconds timeout)
+{
+#if defined(__linux__)
+    struct timespec ts = {(time_t)(timeout.count() / 1000000000), (long)(timeout.count() % 1000000000)};
+    long result =
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+    return result == 0 || errno != ETIMEDOUT;
+#else
+    // std::atomic::wait has no timeout
+    park_bucket &bucket = park_bucket_of(&word);
+    std::unique_lock<std::mutex> lock(bucket.lock);
+    return bucket.cond.wait_for(lock, timeout, [&] {
+        return word.load() != expected;
+    });
+#endif
+}
+
+/**
+ * @brief Change word and wake up to count threads parked on it, INT_MAX wakes all of them.
+ */
+inline void atomic_unpark(std::atomic<uint32_t> &word, int count)
+{
+    word++;
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+#if __cplusplus >= 202002L
+    if (count == INT_MAX) {
+        word.notify_all();
+    } else {
+        for (int i = 0; i < count; i++) {
+            word.notify_one();
         }
     }
-    ~threadpool()
-    {
-        shutdown();
-    }
-
-    void pause()
+#endif
+    // taking the lock orders the change before a waiter checking the word under it
+    park_bucket &bucket = park_bucket_of(&word);
     {
-        paused = true;
+        std::lock_guard<std::mutex> guard(bucket.lock);
     }
+    bucket.cond.notify_all();
+#endif
+}
 
-    void resume()
+/**
+ * @brief Bounded multi-producer multi-consumer queue, see Dmitry Vyukov's "Bounded MPMC queue". Every cell carries a
+ * sequence number telling producers and consumers whose turn it is, so a push or pop is a single CAS on the tail or
+ * head index. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class mpmc_queue {
+  public:
+    explicit mpmc_queue(size_t capacity = 4096) : head(0), tail(0)
     {
-        paused = false;
-        if constexpr (strategy == CONDITION_VARIABLE) {
-            queue_cond.notify_all();
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells.reset(new cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
         }
     }
 
-    void wait()
+    mpmc_queue(const mpmc_queue &) = delete;
+    mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+    bool try_push(T &&item)
     {
+        cell *c;
+        size_t pos = tail.load(std::memory_order_relaxed);
         while (true) {
-            if (!paused) {
-                if (unfinished_task_size == 0) {
-                    THREADPOOL_TRACE("All tasks have been executed");
+            c = &cells[pos & mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
                     break;
                 }
+            } else if (diff < 0) {
+                return false; // full
             } else {
-                if (get_task_size_running() == 0) {
-                    THREADPOOL_TRACE("No task running");
-                    break;
-                }
+                pos = tail.load(std::memory_order_relaxed);
             }
+        }
+        c->data = std::move(item);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
 
-            if constexpr (strategy == CONDITION_VARIABLE) {
-                THREADPOOL_TRACE("Idle");
-                std::unique_lock<std::mutex> lock(queue_lock);
-                queue_cond.wait(lock, [this] {
-                    return stopped || (!paused || !task_queue.empty());
-                });
+    /**
+     * @brief Reserve up to n consecutive free cells with a single CAS and fill them with next(). Returns the number of
+     * items pushed, 0 if the queue is full.
+     */
+    template <typename Generator>
+    size_t try_push_n(size_t n, Generator &&next)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed), k;
+        while (true) {
+            for (k = 0; k < n; k++) {
+                if (cells[(pos + k) & mask].sequence.load(std::memory_order_acquire) != pos + k) {
+                    break;
+                }
             }
-            if constexpr (strategy == YIELD_OR_SCHED_DURATION) {
-                THREADPOOL_TRACE("Idle");
-                if (duration == 0) {
-                    std::this_thread::yield();
-                } else {
-                    std::this_thread::sleep_for(std::chrono::microseconds(duration));
+            if (k == 0) {
+                size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                if ((intptr_t)seq - (intptr_t)pos < 0) {
+                    return 0; // full
                 }
+                pos = tail.load(std::memory_order_relaxed);
+            } else if (tail.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
             }
         }
+        for (size_t i = 0; i < k; i++) {
+            cell &c = cells[(pos + i) & mask];
+            c.data = next();
+            c.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return k;
     }
 
-    void shutdown()
+    bool try_pop(T &item)
     {
-        if (!stopped) {
-            stopped = true;
-            if constexpr (strategy == CONDITION_VARIABLE) {
-                queue_cond.notify_all();
-            }
-
-            for (size_type i = 0; i < concurrency; i++) {
-                workers[i].join();
+        cell *c;
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            c = &cells[pos & mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = head.load(std::memory_order_relaxed);
             }
         }
+        item = std::move(c->data);
+        c->data = T();
+        c->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
     }
 
-    void set_duration(size_t duration_ms)
+    size_t size() const
     {
-        duration = duration_ms;
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
     }
 
-    size_t get_duration()
+    bool empty() const
     {
-        return duration;
+        return size() == 0;
     }
 
-    void reset(size_type worker_size = std::thread::hardware_concurrency())
+    size_t capacity() const
     {
-#if 0
-        bool was_paused = paused;
-        if (!was_paused) {
-            pause();
-        }
-        wait();
-        for (size_type i = 0; i < concurrency; i++) {
-            workers[i].join();
-        }
-#endif
-        shutdown();
-        concurrency = worker_size;
-        workers.reset(new std::thread[concurrency]);
-        for (size_type i = 0; i < concurrency; i++) {
-            workers[i] = std::thread(&threadpool::__worker, this);
+        return mask + 1;
+    }
+
+  private:
+    struct cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    size_t mask;
+    std::unique_ptr<cell[]> cells;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+/**
+ * @brief Move-only replacement of std::function. Callables of up to inline_size bytes that can be moved without
+ * throwing are stored in place, larger ones on the heap. Being move-only, it can hold a std::packaged_task or a lambda
+ * capturing a std::promise.
+ */
+template <typename Signature>
+class unique_function;
+
+template <typename R, typename... Args>
+class unique_function<R(Args...)> {
+  public:
+    static constexpr size_t inline_size = 64;
+
+    unique_function() noexcept = default;
+    unique_function(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Callable = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Callable, unique_function>
+                                          && std::is_invocable_r_v<R, Callable &, Args...>>>
+    unique_function(F &&f)
+    {
+        if constexpr (stored_inline<Callable>) {
+            new (storage) Callable(std::forward<F>(f));
+            ops = &inline_operations<Callable>::table;
+        } else {
+            *reinterpret_cast<Callable **>(storage) = new Callable(std::forward<F>(f));
+            ops = &heap_operations<Callable>::table;
         }
-#if 0
-        if (!was_paused) {
-            resume();
+    }
+
+    unique_function(unique_function &&other) noexcept
+    {
+        __take(other);
+    }
+
+    unique_function &operator=(unique_function &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            __take(other);
         }
-#endif
+        return *this;
     }
 
-    bool is_alive()
+    unique_function(const unique_function &) = delete;
+    unique_function &operator=(const unique_function &) = delete;
+
+    ~unique_function()
     {
-        return !stopped;
+        reset();
     }
 
-    bool is_active()
+    void reset() noexcept
     {
-        return !stopped && !paused;
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
     }
 
-    size_type get_worker_size() const
+    explicit operator bool() const noexcept
     {
-        return concurrency;
+        return ops != nullptr;
     }
 
-    size_type get_task_size_unfinished() const
+    /* true if the callable has a cancelled() member returning true: calling it would do nothing, queues may drop it */
+    bool cancelled() const noexcept
     {
-        return unfinished_task_size;
+        return ops && ops->cancelled(storage);
     }
 
-    size_type get_task_size_queued() const
+    R operator()(Args... args)
     {
-        std::lock_guard<std::mutex> guard(queue_lock);
-        return task_queue.size();
+        return ops->invoke(storage, std::forward<Args>(args)...);
     }
 
-    size_type get_task_size_running() const
+  private:
+    struct operations {
+        R (*invoke)(void *, Args &&...);
+        void (*move)(void *from, void *to) noexcept;
+        void (*destroy)(void *) noexcept;
+        bool (*cancelled)(const void *) noexcept;
+    };
+
+    template <typename F, typename = void>
+    struct __has_cancelled : std::false_type {
+    };
+    template <typename F>
+    struct __has_cancelled<F, std::void_t<decltype(std::declval<const F &>().cancelled())>> : std::true_type {
+    };
+
+    template <typename F>
+    static bool __cancelled(const F &f) noexcept
     {
-        std::lock_guard<std::mutex> guard(queue_lock);
-        return unfinished_task_size - task_queue.size();
+        if constexpr (__has_cancelled<F>::value) {
+            return f.cancelled();
+        } else {
+            return false;
+        }
     }
 
-    template <typename T1, typename T2, typename TaskLoop>
-    void parallelize(T1 first_index, T2 index_after_last, const TaskLoop &task_loop, size_type num_blocks = 0)
+    template <typename F>
+    static constexpr bool stored_inline = sizeof(F) <= inline_size && alignof(F) <= alignof(std::max_align_t)
+                                          && std::is_nothrow_move_constructible_v<F>;
+
+    template <typename F>
+    static R __invoke(F &f, Args &&...args)
     {
-        typedef std::common_type_t<T1, T2> T;
-        T the_first_index = (T)first_index;
-        T last_index = (T)index_after_last;
-        if (the_first_index == last_index) return;
-        if (last_index < the_first_index) {
-            T temp = last_index;
-            last_index = the_first_index;
-            the_first_index = temp;
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(f, std::forward<Args>(args)...);
+        } else {
+            return std::invoke(f, std::forward<Args>(args)...);
         }
-        last_index--;
-        if (num_blocks == 0) num_blocks = concurrency;
-        size_t total_size = (size_t)(last_index - the_first_index + 1);
-        size_t block_size = (size_t)(total_size / num_blocks);
-        if (block_size == 0) {
-            block_size = 1;
-            num_blocks = (unsigned int)total_size > 1 ? (unsigned int)total_size : 1;
+    }
+
+    template <typename F>
+    struct inline_operations {
+        static R invoke(void *p, Args &&...args)
+        {
+            return __invoke(*static_cast<F *>(p), std::forward<Args>(args)...);
         }
-        std::atomic<unsigned int> blocks_running = 0;
-        for (unsigned int t = 0; t < num_blocks; t++) {
-            T start = ((T)(t * block_size) + the_first_index);
-            T end = (t == num_blocks - 1) ? last_index + 1 : ((T)((t + 1) * block_size) + the_first_index);
-            blocks_running++;
-            push([start, end, &task_loop, &blocks_running] {
-                task_loop(start, end);
-                blocks_running--;
-            });
+        static void move(void *from, void *to) noexcept
+        {
+            new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
         }
-        while (blocks_running != 0) {
-            if constexpr (strategy == CONDITION_VARIABLE) {
-                std::unique_lock<std::mutex> lock(queue_lock);
-                queue_cond.wait(lock, [this] {
-                    return stopped || (!paused || !task_queue.empty());
-                });
-            }
-            if constexpr (strategy == YIELD_OR_SCHED_DURATION) {
-                if (duration == 0) {
-                    std::this_thread::yield();
-                } else {
-                    std::this_thread::sleep_for(std::chrono::microseconds(duration));
-                }
-            }
+        static void destroy(void *p) noexcept
+        {
+            static_cast<F *>(p)->~F();
         }
-    }
+        static bool cancelled(const void *p) noexcept
+        {
+            return __cancelled(*static_cast<const F *>(p));
+        }
+        static constexpr operations table = {&invoke, &move, &destroy, &cancelled};
+    };
 
-    template <typename Task>
-    void push(const Task &task)
-    {
-        unfinished_task_size++;
+    template <typename F>
+    struct heap_operations {
+        static R invoke(void *p, Args &&...args)
         {
-            std::lock_guard<std::mutex> guard(queue_lock);
-            task_queue.push(std::function<void()>(task));
+            return __invoke(**static_cast<F **>(p), std::forward<Args>(args)...);
         }
-        if constexpr (strategy == CONDITION_VARIABLE) {
-            queue_cond.notify_one();
+        static void move(void *from, void *to) noexcept
+        {
+            *static_cast<F **>(to) = *static_cast<F **>(from);
         }
-    }
+        static void destroy(void *p) noexcept
+        {
+            delete *static_cast<F **>(p);
+        }
+        static bool cancelled(const void *p) noexcept
+        {
+            return __cancelled(**static_cast<F *const *>(p));
+        }
+        static constexpr operations table = {&invoke, &move, &destroy, &cancelled};
+    };
 
-    template <typename Task, typename... Args>
-    void push(const Task &task, Args... args)
+    void __take(unique_function &other) noexcept
     {
-        push([task, &args...] {
-            task(args...);
-        });
+        if (other.ops) {
+            other.ops->move(other.storage, storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
     }
 
-    template <typename T, typename... Args, void (T::*Task)(Args...)>
-    void push(typename T::Task *task, Args... args)
+    alignas(std::max_align_t) unsigned char storage[inline_size];
+    const operations *ops = nullptr;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque, see "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.).
+ * Only the owner thread may push() and pop() at the bottom, any thread may steal() from the top. Retired buffers are
+ * kept until the deque is destroyed because a thief may still read from them. Queued items are owned by the deque.
+ */
+template <typename T>
+class chase_lev_deque {
+  public:
+    explicit chase_lev_deque(int64_t capacity = 256) : top(0), bottom(0), buffer(new ring(capacity)) {}
+    ~chase_lev_deque()
     {
-        push([task, &args...] {
-            task(args...);
-        });
+        while (T *item = pop()) {
+            delete item;
+        }
+        delete buffer.load(std::memory_order_relaxed);
     }
 
-    /**
-     * @brief Submit a function with zero or more arguments and no return value into the task queue, and get an
-     * std::future<bool> that will be set to true upon completion of the task.
-     *
-     * @tparam Task The type of the function.
-     * @tparam Args The types of the zero or more arguments to pass to the function.
-     * @param task The function to submit.
-     * @param args The zero or more arguments to pass to the function.
-     * @return A future to be used later to check if the function has finished its execution.
-     */
-    template <
-        typename Task, typename... Args,
-        typename = std::enable_if_t<std::is_void_v<std::invoke_result_t<std::decay_t<Task>, std::decay_t<Args>...>>>>
-    std::future<bool> submit(const Task &task, const Args &...args)
-    {
-        std::shared_ptr<std::promise<bool>> promise(new std::promise<bool>);
-        std::future<bool> future = promise->get_future();
-        push([task, args..., promise] {
-            try {
-                task(args...);
-                promise->set_value(true);
-            } catch (...) {
-                try {
-                    promise->set_exception(std::current_exception());
-                } catch (...) {
-                }
-            }
-        });
-        return future;
+    chase_lev_deque(const chase_lev_deque &) = delete;
+    chase_lev_deque &operator=(const chase_lev_deque &) = delete;
+
+    void push(T *item)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        ring *r = buffer.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            retired.emplace_back(r);
+            r = r->grow(t, b);
+            buffer.store(r, std::memory_order_release);
+        }
+        r->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
     }
 
-    /**
-     * @brief Submit a function with zero or more arguments and a return value into the task queue, and get a future for
-     * its eventual returned value.
-     *
-     * @tparam Task The type of the function.
-     * @tparam Args The types of the zero or more arguments to pass to the function.
-     * @tparam Result The return type of the function.
-     * @param task The function to submit.
-     * @param args The zero or more arguments to pass to the function.
-     * @return A future to be used later to obtain the function's returned value, waiting for it to finish its execution
-     * if needed.
-     */
-    template <typename Task, typename... Args,
-              typename Result = std::invoke_result_t<std::decay_t<Task>, std::decay_t<Args>...>,
-              typename = std::enable_if_t<!std::is_void_v<Result>>>
-    std::future<Result> submit(const Task &task, const Args &...args)
+    T *pop()
     {
-        std::shared_ptr<std::promise<Result>> promise(new std::promise<Result>);
-        std::future<Result> future = promise->get_future();
-        push([task, &args..., promise] {
-            try {
-                promise->set_value(task(args...));
-            } catch (...) {
-                try {
-                    promise->set_exception(std::current_exception());
-                } catch (...) {
-                }
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        ring *r = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T *item = r->get(b);
+        if (t == b) {
+            // last item, race against thieves
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
             }
-        });
-        return future;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
     }
 
-  public:
-    void __worker()
+    T *steal()
     {
-        if constexpr (strategy == CONDITION_VARIABLE) {
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(queue_lock);
-                    queue_cond.wait(lock, [this] {
-                        return stopped || (!paused && !task_queue.empty());
-                    });
-                    if (stopped && task_queue.empty()) {
-                        return;
-                    }
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
 
-                    task = std::move(task_queue.front());
-                    task_queue.pop();
+        T *item = buffer.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr; // lost the race against the owner or another thief
+        }
+        return item;
+    }
+
+    size_t size() const
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? (size_t)(b - t) : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+  private:
+    struct ring {
+        explicit ring(int64_t capacity)
+            : capacity(capacity), mask(capacity - 1), slots(new std::atomic<T *>[(size_t)capacity])
+        {
+        }
+
+        void put(int64_t i, T *item)
+        {
+            slots[i & mask].store(item, std::memory_order_relaxed);
+        }
+
+        T *get(int64_t i) const
+        {
+            return slots[i & mask].load(std::memory_order_relaxed);
+        }
+
+        ring *grow(int64_t t, int64_t b) const
+        {
+            ring *r = new ring(capacity * 2);
+            for (int64_t i = t; i < b; i++) {
+                r->put(i, get(i));
+            }
+            return r;
+        }
+
+        int64_t capacity, mask; /* capacity is always a power of two */
+        std::unique_ptr<std::atomic<T *>[]> slots;
+    };
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<ring *> buffer;
+    std::vector<std::unique_ptr<ring>> retired; /* touched by the owner only */
+};
+
+/**
+ * @brief Thrown by task_future::get() for a task cancelled before it started.
+ */
+class task_cancelled : public std::exception {
+  public:
+    const char *what() const noexcept override
+    {
+        return "task cancelled";
+    }
+};
+
+/* reference count and progress of a submitted task, the part a stop_token shares */
+struct stop_state {
+    static constexpr uint32_t STARTED = 1, STOP = 2;
+
+    virtual ~stop_state() = default;
+
+    void release()
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    std::atomic<uint32_t> refs = 2; /* the future and the task, plus the stop tokens */
+    std::atomic<uint32_t> phase = 0;
+};
+
+/**
+ * @brief Passed to tasks submitted with a stop_token first parameter, to poll whether task_future::cancel() was called
+ * while they run.
+ */
+class stop_token {
+  public:
+    stop_token() noexcept = default;
+    explicit stop_token(stop_state *s) noexcept : s(s)
+    {
+        s->refs++;
+    }
+    stop_token(const stop_token &other) noexcept : stop_token()
+    {
+        *this = other;
+    }
+    stop_token &operator=(const stop_token &other) noexcept
+    {
+        if (other.s) {
+            other.s->refs++;
+        }
+        if (s) {
+            s->release();
+        }
+        s = other.s;
+        return *this;
+    }
+    ~stop_token()
+    {
+        if (s) {
+            s->release();
+        }
+    }
+
+    bool stop_requested() const noexcept
+    {
+        return s && (s->phase.load(std::memory_order_relaxed) & stop_state::STOP) != 0;
+    }
+
+    bool stop_possible() const noexcept
+    {
+        return s != nullptr;
+    }
+
+  private:
+    stop_state *s = nullptr;
+};
+
+/**
+ * @brief Result of threadpool::submit(). The callable, its result and the ready flag live in one heap block shared by
+ * the queued task and the future, so a submit costs a single allocation. The interface follows std::future, plus
+ * cancel().
+ */
+template <typename R>
+class task_future {
+  public:
+    struct state : stop_state {
+        virtual void run() = 0;
+        virtual void discard() noexcept = 0; /* destroy the callable of a task that will not run */
+
+        void finish()
+        {
+            atomic_unpark(ready, INT_MAX);
+#if defined(THREADPOOL_COROUTINES)
+            // this marks the state as finished for a later await, or resumes the coroutine already waiting
+            if (void *waiting = continuation.exchange(this)) {
+                std::coroutine_handle<>::from_address(waiting).resume();
+            }
+#endif
+        }
+
+        std::atomic<uint32_t> ready = 0;
+        std::optional<R> result;
+        std::exception_ptr error;
+#if defined(THREADPOOL_COROUTINES)
+        std::atomic<void *> continuation = nullptr;
+#endif
+    };
+
+    /* the queued part, holds the second reference and breaks the promise if destroyed without running */
+    class task {
+      public:
+        explicit task(state *s) noexcept : s(s) {}
+        task(task &&other) noexcept : s(other.s)
+        {
+            other.s = nullptr;
+        }
+        task(const task &) = delete;
+        ~task()
+        {
+            if (s) {
+                if ((s->phase.fetch_or(stop_state::STARTED) & stop_state::STOP) == 0) {
+                    s->error = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+                    s->finish();
+                }
+                s->release();
+            }
+        }
+
+        void operator()()
+        {
+            state *current = s;
+            s = nullptr;
+            // cancel() has finished the future of a task it stopped before it started
+            if ((current->phase.fetch_or(stop_state::STARTED) & stop_state::STOP) == 0) {
+                current->run();
+                current->finish();
+            }
+            current->release();
+        }
+
+        bool cancelled() const noexcept
+        {
+            return s && (s->phase.load(std::memory_order_relaxed) & stop_state::STOP) != 0;
+        }
+
+      private:
+        state *s;
+    };
+
+    task_future() noexcept : s(nullptr) {}
+    explicit task_future(state *s) noexcept : s(s) {}
+    task_future(task_future &&other) noexcept : s(other.s)
+    {
+        other.s = nullptr;
+    }
+    task_future &operator=(task_future &&other) noexcept
+    {
+        if (this != &other) {
+            if (s) {
+                s->release();
+            }
+            s = other.s;
+            other.s = nullptr;
+        }
+        return *this;
+    }
+    task_future(const task_future &) = delete;
+    task_future &operator=(const task_future &) = delete;
+    ~task_future()
+    {
+        if (s) {
+            s->release();
+        }
+    }
+
+    bool valid() const noexcept
+    {
+        return s != nullptr;
+    }
+
+    bool is_ready() const noexcept
+    {
+        return s && s->ready.load(std::memory_order_acquire) != 0;
+    }
+
+    /**
+     * @brief Cancel the task. If it has not started it never will: the future becomes ready at once with
+     * task_cancelled, the callable is destroyed, and the queued entry is skipped or compacted away by the pool. A
+     * running task only sees its stop_token report stop_requested(). Returns true if the task was stopped before it
+     * started.
+     */
+    bool cancel() noexcept
+    {
+        if (!s || (s->phase.fetch_or(stop_state::STOP) & stop_state::STARTED) != 0) {
+            return false;
+        }
+        s->discard();
+        s->error = std::make_exception_ptr(task_cancelled());
+        s->finish();
+        return true;
+    }
+
+    void wait() const
+    {
+        while (s->ready.load(std::memory_order_acquire) == 0) {
+            atomic_park(s->ready, 0);
+        }
+    }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) const
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (s->ready.load(std::memory_order_acquire) == 0) {
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= remaining.zero()) {
+                return std::future_status::timeout;
+            }
+            atomic_park_for(s->ready, 0, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        }
+        return std::future_status::ready;
+    }
+
+    R get()
+    {
+        if (!s) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        wait();
+        std::unique_ptr<state, void (*)(state *)> current(s, [](state *p) {
+            p->release();
+        });
+        s = nullptr;
+        if (current->error) {
+            std::rethrow_exception(current->error);
+        }
+        return std::move(*current->result);
+    }
+
+#if defined(THREADPOOL_COROUTINES)
+    /* co_await future resumes the coroutine on the thread that finished the task, then returns get() */
+    bool await_ready() const noexcept
+    {
+        return is_ready();
+    }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        void *expected = nullptr;
+        return s->continuation.compare_exchange_strong(expected, awaiting.address());
+    }
+
+    R await_resume()
+    {
+        return get();
+    }
+#endif
+
+    /* build the shared block for a callable returning R, and the task to queue */
+    template <typename F>
+    static std::pair<task_future, task> make(F &&f)
+    {
+        struct block : state {
+            explicit block(F &&f) : fn(std::forward<F>(f)) {}
+            void run() override
+            {
+                try {
+                    if constexpr (std::is_invocable_v<std::decay_t<F> &, stop_token>) {
+                        this->result.emplace((*fn)(stop_token(this)));
+                    } else {
+                        this->result.emplace((*fn)());
+                    }
+                } catch (...) {
+                    this->error = std::current_exception();
+                }
+            }
+            void discard() noexcept override
+            {
+                fn.reset();
+            }
+            std::optional<std::decay_t<F>> fn;
+        };
+        state *s = new block(std::forward<F>(f));
+        return {task_future(s), task(s)};
+    }
+
+  private:
+    state *s;
+};
+
+/**
+ * @brief Single completion handle for a batch of tasks, see threadpool::push_batch() and threadpool::submit_range().
+ * The handle and every task of the batch share one counter block, get() rethrows the first exception of the batch.
+ */
+class batch_future {
+  public:
+    struct state {
+        explicit state(size_t size) : refs(size + 1), remaining(size), ready(size == 0 ? 1 : 0) {}
+        virtual ~state() = default;
+
+        void release()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+        void fail(std::exception_ptr e)
+        {
+            if (!failed.test_and_set()) {
+                error = e;
+            }
+        }
+
+        void done()
+        {
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                atomic_unpark(ready, INT_MAX);
+            }
+        }
+
+        std::atomic<size_t> refs;
+        std::atomic<size_t> remaining;
+        std::atomic<uint32_t> ready;
+        std::atomic_flag failed = ATOMIC_FLAG_INIT;
+        std::exception_ptr error;
+    };
+
+    /* one task of the batch, counted as failed if destroyed without running */
+    template <typename F>
+    class task {
+      public:
+        task(state *s, F &&fn) : s(s), fn(std::move(fn)) {}
+        task(task &&other) noexcept : s(other.s), fn(std::move(other.fn))
+        {
+            other.s = nullptr;
+        }
+        task(const task &) = delete;
+        ~task()
+        {
+            if (s) {
+                s->fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                s->done();
+                s->release();
+            }
+        }
+
+        void operator()()
+        {
+            state *current = s;
+            s = nullptr;
+            try {
+                fn();
+            } catch (...) {
+                current->fail(std::current_exception());
+            }
+            current->done();
+            current->release();
+        }
+
+      private:
+        state *s;
+        F fn;
+    };
+
+    batch_future() noexcept : s(nullptr), count(0) {}
+    explicit batch_future(state *s, size_t count) noexcept : s(s), count(count) {}
+    batch_future(batch_future &&other) noexcept : s(other.s), count(other.count)
+    {
+        other.s = nullptr;
+    }
+    batch_future &operator=(batch_future &&other) noexcept
+    {
+        if (this != &other) {
+            if (s) {
+                s->release();
+            }
+            s = other.s;
+            count = other.count;
+            other.s = nullptr;
+        }
+        return *this;
+    }
+    batch_future(const batch_future &) = delete;
+    batch_future &operator=(const batch_future &) = delete;
+    ~batch_future()
+    {
+        if (s) {
+            s->release();
+        }
+    }
+
+    bool valid() const noexcept
+    {
+        return s != nullptr;
+    }
+
+    /* number of tasks in the batch */
+    size_t size() const noexcept
+    {
+        return count;
+    }
+
+    bool is_ready() const noexcept
+    {
+        return s && s->ready.load(std::memory_order_acquire) != 0;
+    }
+
+    void wait() const
+    {
+        while (s->ready.load(std::memory_order_acquire) == 0) {
+            atomic_park(s->ready, 0);
+        }
+    }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) const
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (s->ready.load(std::memory_order_acquire) == 0) {
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= remaining.zero()) {
+                return std::future_status::timeout;
+            }
+            atomic_park_for(s->ready, 0, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        }
+        return std::future_status::ready;
+    }
+
+    void get()
+    {
+        if (!s) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        wait();
+        std::unique_ptr<state, void (*)(state *)> current(s, [](state *p) {
+            p->release();
+        });
+        s = nullptr;
+        if (current->error) {
+            std::rethrow_exception(current->error);
+        }
+    }
+
+  private:
+    state *s;
+    size_t count;
+};
+
+/**
+ * @brief How threadpool::parallelize() and threadpool::submit_range() hand out the indices of a range, after OpenMP.
+ * STATIC cuts the range into equal blocks up front. DYNAMIC and GUIDED queue one claiming task per worker instead,
+ * and every claiming task takes the next chunk from a shared atomic index until the range is exhausted: DYNAMIC
+ * chunks have a fixed size, GUIDED chunks shrink with the remaining range down to a minimum size. Claiming balances
+ * ranges whose indices have very different costs, at the price of one atomic operation per chunk.
+ */
+struct schedule {
+    enum kind_type { STATIC, DYNAMIC, GUIDED };
+
+    kind_type kind;
+    size_t chunk; /* number of blocks for STATIC (0 for the worker size), (minimum) chunk size otherwise */
+
+    static schedule blocks(size_t num_blocks = 0)
+    {
+        return {STATIC, num_blocks};
+    }
+
+    static schedule dynamic(size_t chunk_size = 1)
+    {
+        return {DYNAMIC, chunk_size > 0 ? chunk_size : 1};
+    }
+
+    static schedule guided(size_t min_chunk_size = 1)
+    {
+        return {GUIDED, min_chunk_size > 0 ? min_chunk_size : 1};
+    }
+};
+
+/**
+ * @brief Urgency of a task pushed with threadpool::push_prioritized(). Prioritized tasks wait in one heap ordered by
+ * deadline, earliest first. A task without an explicit deadline gets the time it was pushed plus the budget of its
+ * lane (0 for HIGH, 10ms for NORMAL and 100ms for LOW by default, see threadpool::set_lane_budget()), so a LOW task
+ * is overtaken by HIGH tasks for at most its budget and then ages ahead of them: no lane can starve.
+ */
+struct priority {
+    enum lane_type : size_t { HIGH, NORMAL, LOW };
+    static constexpr size_t lanes = 3;
+
+    lane_type lane;
+    std::chrono::steady_clock::time_point deadline;
+
+    priority(lane_type lane = NORMAL) : lane(lane), deadline(std::chrono::steady_clock::time_point::max()) {}
+
+    /* start before deadline, the lane only counts for the metrics */
+    static priority before(std::chrono::steady_clock::time_point deadline, lane_type lane = NORMAL)
+    {
+        priority p(lane);
+        p.deadline = deadline;
+        return p;
+    }
+};
+
+/**
+ * @brief Latency of one lane of prioritized tasks, the time between push_prioritized() and the start of the task.
+ */
+struct lane_metrics {
+    size_t queued;   /* pushed but not started yet */
+    size_t executed; /* started */
+    size_t missed;   /* started after their deadline */
+    std::chrono::nanoseconds mean_latency;
+    std::chrono::nanoseconds max_latency;
+};
+
+/**
+ * @brief The CPUs of each NUMA node, for threadpool::place(). detect() reads /sys/devices/system/node and falls back
+ * to a single node holding every CPU; simulated() builds an arbitrary layout for testing on single node machines.
+ */
+struct cpu_topology {
+    std::vector<std::vector<int>> nodes;
+
+    /* parse a kernel cpu list such as "0-3,8,10-11" */
+    static std::vector<int> parse_cpu_list(const std::string &list)
+    {
+        std::vector<int> cpus;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos) end = list.size();
+            std::string range = list.substr(pos, end - pos);
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+            } catch (const std::exception &) {
+                // blank or malformed entry, e.g. the newline at the end of the file
+            }
+            pos = end + 1;
+        }
+        return cpus;
+    }
+
+    static cpu_topology detect(const std::string &root = "/sys/devices/system/node")
+    {
+        cpu_topology topology;
+        std::string possible;
+        std::ifstream(root + "/possible") >> possible;
+        for (int node : parse_cpu_list(possible)) {
+            std::string list;
+            std::ifstream(root + "/node" + std::to_string(node) + "/cpulist") >> list;
+            std::vector<int> cpus = parse_cpu_list(list);
+            if (!cpus.empty()) topology.nodes.push_back(std::move(cpus));
+        }
+        if (topology.nodes.empty()) {
+            topology.nodes.emplace_back();
+            for (int cpu = 0; cpu < (int)std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+                topology.nodes[0].push_back(cpu);
+            }
+        }
+        return topology;
+    }
+
+    static cpu_topology simulated(size_t node_count, size_t cpus_per_node)
+    {
+        cpu_topology topology;
+        for (size_t node = 0; node < node_count; node++) {
+            topology.nodes.emplace_back();
+            for (size_t cpu = 0; cpu < cpus_per_node; cpu++) {
+                topology.nodes[node].push_back((int)(node * cpus_per_node + cpu));
+            }
+        }
+        return topology;
+    }
+
+    size_t cpu_count() const
+    {
+        size_t count = 0;
+        for (const auto &cpus : nodes) count += cpus.size();
+        return count;
+    }
+};
+
+/**
+ * @brief Log-linear histogram of nanoseconds in the style of HDR histograms: 16 linear sub-buckets per power of two,
+ * so any recorded value is known within about 6%, from 1ns to the full 64-bit range in 976 buckets.
+ */
+struct log_histogram {
+    static constexpr unsigned sub_bits = 4;
+    static constexpr size_t bucket_count = (64 - sub_bits + 1) << sub_bits;
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(bucket_count);
+    uint64_t total = 0, sum = 0, max = 0;
+
+    static size_t index_of(uint64_t value)
+    {
+        if (value < (1u << sub_bits)) {
+            return (size_t)value;
+        }
+        unsigned exponent = 0;
+        for (unsigned shift = 32; shift > 0; shift >>= 1) {
+            if (value >> (exponent + shift)) exponent += shift;
+        }
+        return ((size_t)(exponent - sub_bits + 1) << sub_bits)
+               + (size_t)((value >> (exponent - sub_bits)) & ((1u << sub_bits) - 1));
+    }
+
+    /* smallest value that falls into the bucket */
+    static uint64_t lowest_of(size_t index)
+    {
+        if (index < (1u << sub_bits)) {
+            return index;
+        }
+        unsigned exponent = (unsigned)(index >> sub_bits) + sub_bits - 1;
+        return (uint64_t)((1u << sub_bits) | (index & ((1u << sub_bits) - 1))) << (exponent - sub_bits);
+    }
+
+    void record(uint64_t value, uint64_t count = 1)
+    {
+        counts[index_of(value)] += count;
+        total += count;
+        sum += value * count;
+        max = std::max(max, value);
+    }
+
+    void merge(const log_histogram &other)
+    {
+        for (size_t i = 0; i < bucket_count; i++) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    /* value below which percent of the recorded values fall, as the middle of its bucket */
+    uint64_t percentile(double percent) const
+    {
+        uint64_t rank = (uint64_t)(percent / 100.0 * (double)total + 0.5), seen = 0;
+        for (size_t i = 0; i < bucket_count; i++) {
+            seen += counts[i];
+            if (seen >= std::max<uint64_t>(rank, 1)) {
+                uint64_t low = lowest_of(i), high = i + 1 < bucket_count ? lowest_of(i + 1) : max;
+                return std::min(max, low + (high - low) / 2);
+            }
+        }
+        return max;
+    }
+
+    double mean() const
+    {
+        return total > 0 ? (double)sum / (double)total : 0.0;
+    }
+};
+
+/**
+ * @brief Snapshot of the instrumentation of a pool, see threadpool::instrument() and threadpool::get_stats().
+ */
+struct threadpool_stats {
+    struct worker {
+        uint64_t executed, busy_ns, idle_ns, steals;
+        log_histogram latency; /* from push to start */
+        log_histogram runtime;
+    };
+
+    std::vector<worker> workers; /* one per worker slot (all of them in elastic mode, see threadpool::elastic()), then
+                                  * one for the tasks run by other threads (helping waits) */
+    size_t queued, unfinished;
+
+    log_histogram latency() const
+    {
+        log_histogram all;
+        for (const auto &w : workers) all.merge(w.latency);
+        return all;
+    }
+
+    log_histogram runtime() const
+    {
+        log_histogram all;
+        for (const auto &w : workers) all.merge(w.runtime);
+        return all;
+    }
+
+    static std::string format_ns(double ns)
+    {
+        const char *units[] = {"ns", "us", "ms", "s"};
+        size_t unit = 0;
+        while (ns >= 1000.0 && unit < 3) {
+            ns /= 1000.0;
+            unit++;
+        }
+        char text[32];
+        snprintf(text, sizeof(text), unit == 0 ? "%.0f%s" : "%.1f%s", ns, units[unit]);
+        return text;
+    }
+
+    /**
+     * @brief One row per worker and a total row, e.g. to_table<tabulate::Table>(). Any type with a variadic add() of
+     * strings works, so this header does not depend on tabulate.h.
+     */
+    template <typename Table>
+    Table to_table() const
+    {
+        Table table;
+        table.add("worker", "tasks", "busy", "idle", "steals", "wait p50", "wait p99", "wait max", "run p50", "run p99",
+                  "run max");
+        auto row = [&table](const std::string &name, uint64_t executed, uint64_t busy, uint64_t idle, uint64_t steals,
+                            const log_histogram &wait, const log_histogram &run) {
+            table.add(name, std::to_string(executed), format_ns((double)busy), format_ns((double)idle),
+                      std::to_string(steals), format_ns((double)wait.percentile(50)),
+                      format_ns((double)wait.percentile(99)), format_ns((double)wait.max),
+                      format_ns((double)run.percentile(50)), format_ns((double)run.percentile(99)),
+                      format_ns((double)run.max));
+        };
+        uint64_t executed = 0, busy = 0, idle = 0, steals = 0;
+        for (size_t i = 0; i < workers.size(); i++) {
+            const worker &w = workers[i];
+            row(i + 1 < workers.size() ? std::to_string(i) : std::string("other"), w.executed, w.busy_ns, w.idle_ns,
+                w.steals, w.latency, w.runtime);
+            executed += w.executed, busy += w.busy_ns, idle += w.idle_ns, steals += w.steals;
+        }
+        row("total", executed, busy, idle, steals, latency(), runtime());
+        return table;
+    }
+};
+
+/**
+ * @brief Hierarchical timing wheel of levels x 64 slots, level k covering 64^k ticks per slot. An entry goes to the
+ * lowest level where its expiry shares the higher digits with the current tick, and moves down a level each time that
+ * level's digit wraps, so insert is O(1) and advancing costs O(1) per wrap of level 0 and expired entry. Expiries past
+ * the top level wait in an overflow list, placed again each time the top level wraps. Not thread safe.
+ */
+template <typename Entry>
+class timing_wheel {
+  public:
+    static constexpr size_t slot_bits = 6, slots = 1 << slot_bits, levels = 4;
+
+    explicit timing_wheel(uint64_t now = 0) : current(now) {}
+
+    uint64_t now() const noexcept
+    {
+        return current;
+    }
+
+    size_t size() const noexcept
+    {
+        return count;
+    }
+
+    /* entries due at or before the current tick expire on the next advance() */
+    void insert(uint64_t expiry, Entry entry)
+    {
+        __place(std::max(expiry, current + 1), std::move(entry));
+    }
+
+    /* move to tick to, calling expired(Entry &&) for every entry due by then, in tick order */
+    template <typename Expired>
+    void advance(uint64_t to, Expired &&expired)
+    {
+        while (current < to) {
+            if (count == 0) {
+                current = to;
+                return;
+            }
+            // jump to the next occupied slot of level 0 or the next wrap, whichever comes first
+            current = std::min(next_expiry(), to);
+            if ((current & (slots - 1)) == 0) {
+                __cascade();
+            }
+            size_t slot = (size_t)current & (slots - 1);
+            if (occupied[0] & (uint64_t(1) << slot)) {
+                std::vector<item> due;
+                due.swap(wheel[0][slot]);
+                occupied[0] &= ~(uint64_t(1) << slot);
+                count -= due.size();
+                for (auto &i : due) expired(std::move(i.entry));
+            }
+        }
+    }
+
+    /* earliest tick at which advance() may have work, at most one wrap of level 0 away; UINT64_MAX if empty */
+    uint64_t next_expiry() const noexcept
+    {
+        if (count == 0) {
+            return UINT64_MAX;
+        }
+        uint64_t offset = current & (slots - 1);
+        uint64_t later = offset + 1 < slots ? occupied[0] & ~((uint64_t(2) << offset) - 1) : 0;
+        return later != 0 ? (current & ~uint64_t(slots - 1)) + __lowest_bit(later) : (current | (slots - 1)) + 1;
+    }
+
+  private:
+    struct item {
+        uint64_t expiry;
+        Entry entry;
+    };
+
+    static uint64_t __lowest_bit(uint64_t bits) noexcept
+    {
+        uint64_t index = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+    }
+
+    void __place(uint64_t expiry, Entry entry)
+    {
+        size_t level = 0;
+        while (level + 1 < levels && (expiry >> (slot_bits * (level + 1))) != (current >> (slot_bits * (level + 1)))) {
+            level++;
+        }
+        count++;
+        if ((expiry >> (slot_bits * levels)) != (current >> (slot_bits * levels))) {
+            overflow.push_back({expiry, std::move(entry)});
+            return;
+        }
+        size_t slot = (size_t)(expiry >> (slot_bits * level)) & (slots - 1);
+        wheel[level][slot].push_back({expiry, std::move(entry)});
+        occupied[level] |= uint64_t(1) << slot;
+    }
+
+    /* current just wrapped level 0: redistribute the slots of the levels whose lower digits are all zero, top first */
+    void __cascade()
+    {
+        size_t top = 1;
+        while (top < levels && ((current >> (slot_bits * top)) & (slots - 1)) == 0) {
+            top++;
+        }
+        if (top == levels) {
+            std::vector<item> moved;
+            moved.swap(overflow);
+            count -= moved.size();
+            for (auto &i : moved) __place(i.expiry, std::move(i.entry));
+            top--;
+        }
+        for (size_t level = top; level >= 1; level--) {
+            size_t slot = (size_t)(current >> (slot_bits * level)) & (slots - 1);
+            if ((occupied[level] & (uint64_t(1) << slot)) == 0) {
+                continue;
+            }
+            std::vector<item> moved;
+            moved.swap(wheel[level][slot]);
+            occupied[level] &= ~(uint64_t(1) << slot);
+            count -= moved.size();
+            for (auto &i : moved) __place(i.expiry, std::move(i.entry));
+        }
+    }
+
+    std::vector<item> wheel[levels][slots];
+    std::vector<item> overflow;
+    uint64_t occupied[levels] = {}; /* one bit per non-empty slot */
+    uint64_t current;
+    size_t count = 0;
+};
+
+/**
+ * @brief Handle of a task scheduled with threadpool::schedule_after() or threadpool::schedule_every(). Dropping the
+ * handle does not cancel the task.
+ */
+class timer_handle {
+  public:
+    struct state {
+        std::atomic<bool> cancelled = false;
+        std::atomic<uint64_t> fired = 0;   /* runs handed to the workers */
+        std::atomic<uint64_t> skipped = 0; /* periods dropped: previous run still going, or the timer fell behind */
+    };
+
+    timer_handle() noexcept = default;
+    explicit timer_handle(std::shared_ptr<state> s) noexcept : s(std::move(s)) {}
+
+    /* no more runs are started, a run already handed to the workers still happens */
+    void cancel() noexcept
+    {
+        if (s) {
+            s->cancelled = true;
+        }
+    }
+
+    bool cancelled() const noexcept
+    {
+        return s && s->cancelled;
+    }
+
+    uint64_t fired() const noexcept
+    {
+        return s ? s->fired.load() : 0;
+    }
+
+    uint64_t skipped() const noexcept
+    {
+        return s ? s->skipped.load() : 0;
+    }
+
+  private:
+    std::shared_ptr<state> s;
+};
+
+template <int strategy = CONDITION_VARIABLE>
+class threadpool {
+  public:
+    using size_type = unsigned int;
+    using task_type = unique_function<void()>;
+    threadpool(size_type concurrency = std::thread::hardware_concurrency(), size_t queue_capacity = 4096)
+        : paused(false), stopped(false), duration(10), task_ring(strategy == LOCK_FREE ? queue_capacity : 2),
+          unfinished_task_size(0)
+    {
+        if constexpr (strategy == WORK_STEALING) {
+            node_queues.reset(new std::queue<task_type>[1]);
+        }
+        __start(concurrency, concurrency);
+    }
+    ~threadpool()
+    {
+        __stop_timers();
+        shutdown();
+    }
+
+    void pause()
+    {
+        paused = true;
+        atomic_unpark(drained, INT_MAX); // wait() returns once the running tasks are done
+    }
+
+    void resume()
+    {
+        paused = false;
+        if constexpr (strategy == CONDITION_VARIABLE) {
+            queue_cond.notify_all();
+        }
+        if constexpr (strategy == WORK_STEALING) {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            queue_cond.notify_all();
+        }
+        if constexpr (strategy == LOCK_FREE) {
+            atomic_unpark(wakeups, INT_MAX);
+        }
+    }
+
+    /**
+     * @brief Wait until every task has finished. Called from inside a task, the tasks running on the calling thread
+     * are not waited for and it runs queued tasks meanwhile, so a single worker does not deadlock on itself.
+     */
+    void wait()
+    {
+        const size_type self = __running_here();
+        while (true) {
+            if (!paused) {
+                if (unfinished_task_size <= self) {
+                    THREADPOOL_TRACE("All tasks have been executed");
+                    break;
+                }
+                if (self != 0 && __run_pending()) {
+                    continue;
+                }
+            } else if (get_task_size_running() <= self) {
+                THREADPOOL_TRACE("No task running");
+                break;
+            }
+
+            // running tasks are not counted down to zero while paused, nor below the tasks of this thread: poll them
+            if (paused || self != 0) {
+                if (duration == 0) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(duration));
+                }
+                continue;
+            }
+
+            // sleep until the last unfinished task is done by the workers
+            waiters++;
+            uint32_t seen = drained.load();
+            if (unfinished_task_size != 0 && !paused) {
+                atomic_park(drained, seen);
+            }
+            waiters--;
+        }
+    }
+
+    /**
+     * @brief Wait until every task of the batch has finished. The calling thread runs queued tasks meanwhile and
+     * sleeps when there is nothing left to run, so it can also be called from inside a task.
+     */
+    void wait(const batch_future &batch)
+    {
+        while (batch.valid() && !batch.is_ready()) {
+            if (!paused && __run_pending()) {
+                continue;
+            }
+            batch.wait();
+        }
+    }
+
+    void shutdown()
+    {
+        if (!stopped) {
+            stopped = true;
+            if constexpr (strategy == CONDITION_VARIABLE) {
+                queue_cond.notify_all();
+            }
+            if constexpr (strategy == WORK_STEALING) {
+                std::lock_guard<std::mutex> guard(queue_lock);
+                queue_cond.notify_all();
+            }
+            if constexpr (strategy == LOCK_FREE) {
+                atomic_unpark(wakeups, INT_MAX);
+            }
+
+            {
+                // a spawn in progress completes, later ones see stopped
+                std::lock_guard<std::mutex> guard(elastic_lock);
+            }
+            for (size_type i = 0; i < capacity; i++) {
+                if (workers[i].joinable()) {
+                    workers[i].join();
+                }
+            }
+        }
+    }
+
+    void set_duration(size_t duration_ms)
+    {
+        duration = duration_ms;
+    }
+
+    size_t get_duration()
+    {
+        return duration;
+    }
+
+    void reset(size_type worker_size = std::thread::hardware_concurrency())
+    {
+#if 0
+        bool was_paused = paused;
+        if (!was_paused) {
+            pause();
+        }
+        wait();
+        for (size_type i = 0; i < concurrency; i++) {
+            workers[i].join();
+        }
+#endif
+        shutdown();
+        elastic_max = 0;
+        __start(worker_size, worker_size);
+#if 0
+        if (!was_paused) {
+            resume();
+        }
+#endif
+    }
+
+    /**
+     * @brief Rebuild the pool like reset(), with min_workers running and room for max_workers. While all workers are
+     * busy, a worker is added when a task starts after waiting longer than spawn_latency, or when a task is pushed
+     * and no task has started for spawn_latency. A worker that found nothing to run for idle_timeout retires, down to
+     * min_workers (at least 1). Workers only retire when idle, so running tasks are never interrupted. Tasks carry
+     * their push time in this mode, as with instrument().
+     */
+    void elastic(size_type min_workers, size_type max_workers,
+                 std::chrono::nanoseconds spawn_latency = std::chrono::milliseconds(1),
+                 std::chrono::nanoseconds idle_timeout = std::chrono::seconds(1))
+    {
+        shutdown();
+        elastic_min = std::max<size_type>(1, min_workers);
+        elastic_max = std::max(elastic_min, max_workers);
+        elastic_spawn_latency = spawn_latency;
+        elastic_idle_timeout = idle_timeout;
+        __start(elastic_max, elastic_min);
+    }
+
+    /**
+     * @brief Pin worker i to cpus[i % cpus.size()] with pthread_setaffinity_np, again after reset().
+     *
+     * @return false if a worker could not be pinned, or always off Linux.
+     */
+    bool pin(const std::vector<int> &cpus)
+    {
+        pinned_cpus = cpus;
+        bool pinned = !cpus.empty();
+        for (size_type i = 0; i < capacity && !cpus.empty(); i++) {
+            pinned = (!alive[i] || __pin_worker(i, {cpus[i % cpus.size()]})) && pinned;
+        }
+        return pinned;
+    }
+
+    /**
+     * @brief Spread the workers over the nodes of the topology, filling one node after another like the CPU list, and
+     * pin each worker to the CPUs of its node if pin_workers is set. Only work stealing has per-node queues: push()
+     * from outside the pool feeds the shared queue of the caller's node, and a worker tries its own node's queue and
+     * its node mates' deques before going to other nodes. The other strategies keep their single queue (or ring) and
+     * only get pinned. It can be called at any time, tasks already queued on a node move to the first one.
+     *
+     * @return false if the topology has no CPU, or if a worker could not be pinned, or always off Linux when pinning.
+     */
+    bool place(const cpu_topology &layout, bool pin_workers = true)
+    {
+        if (layout.cpu_count() == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(elastic_lock); // __spawn() reads the topology
+        topology = layout;
+        pin_nodes = pin_workers;
+        __publish_nodes();
+        bool pinned = true;
+        for (size_type i = 0; i < capacity && pin_workers; i++) {
+            pinned = (!alive[i] || __pin_worker(i, layout.nodes[get_worker_node(i)])) && pinned;
+        }
+        return pinned;
+    }
+
+    /* node of a worker as laid out by place(), 0 without it */
+    size_type get_worker_node(size_type worker) const
+    {
+        size_t flat = topology.cpu_count(), node = 0;
+        if (flat == 0) {
+            return 0;
+        }
+        for (flat = worker % flat; flat >= topology.nodes[node].size(); node++) {
+            flat -= topology.nodes[node].size();
+        }
+        return (size_type)node;
+    }
+
+    /**
+     * @brief Time every task pushed from now on: the wait from push to start and the run time go to histograms of the
+     * worker that ran it, together with its task count and busy time. Steals are always counted. The timing wraps
+     * each task with its push time, which costs two clock reads per task, so it is off by default. Enabling it clears
+     * the counters.
+     */
+    void instrument(bool enabled = true)
+    {
+        if (enabled && !instrumented) {
+            for (size_type i = 0; i <= capacity; i++) counters[i].clear();
+            counters_since = std::chrono::steady_clock::now();
+        }
+        instrumented = enabled;
+    }
+
+    /* read the counters without locking, each counter is exact but they are not taken at one instant */
+    threadpool_stats get_stats() const
+    {
+        threadpool_stats stats;
+        uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - counters_since)
+                               .count();
+        for (size_type i = 0; i <= capacity; i++) {
+            const worker_counters &c = counters[i];
+            threadpool_stats::worker w;
+            w.executed = c.executed.load(std::memory_order_relaxed);
+            w.busy_ns = c.busy_ns.load(std::memory_order_relaxed);
+            w.idle_ns = i < capacity && elapsed > w.busy_ns ? elapsed - w.busy_ns : 0;
+            w.steals = c.steals.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < log_histogram::bucket_count; b++) {
+                uint64_t waited = c.latency[b].load(std::memory_order_relaxed);
+                uint64_t ran = c.runtime[b].load(std::memory_order_relaxed);
+                if (waited) w.latency.record(log_histogram::lowest_of(b), waited);
+                if (ran) w.runtime.record(log_histogram::lowest_of(b), ran);
+            }
+            // the bucket floors understate sum and max, take the exact ones
+            w.latency.sum = c.latency_sum.load(std::memory_order_relaxed);
+            w.latency.max = c.latency_max.load(std::memory_order_relaxed);
+            w.runtime.sum = w.busy_ns;
+            w.runtime.max = c.runtime_max.load(std::memory_order_relaxed);
+            stats.workers.push_back(std::move(w));
+        }
+        stats.queued = __queued();
+        stats.unfinished = unfinished_task_size;
+        return stats;
+    }
+
+    bool is_alive()
+    {
+        return !stopped;
+    }
+
+    bool is_active()
+    {
+        return !stopped && !paused;
+    }
+
+    size_type get_worker_size() const
+    {
+        return concurrency;
+    }
+
+    /* budget added to the push time of the tasks of a lane that have no explicit deadline */
+    template <typename Rep, typename Period>
+    void set_lane_budget(priority::lane_type lane, const std::chrono::duration<Rep, Period> &budget)
+    {
+        std::lock_guard<std::mutex> guard(lane_lock);
+        lane_budgets[lane] = std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+    }
+
+    lane_metrics get_lane_metrics(priority::lane_type lane) const
+    {
+        const lane_counters &c = lane_stats[lane];
+        size_t executed = c.executed;
+        return {c.queued,
+                executed,
+                c.missed,
+                std::chrono::nanoseconds(executed > 0 ? c.total_latency_ns / (int64_t)executed : 0),
+                std::chrono::nanoseconds(c.max_latency_ns)};
+    }
+
+    size_type get_task_size_unfinished() const
+    {
+        return unfinished_task_size;
+    }
+
+    size_type get_task_size_queued() const
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        return __queued();
+    }
+
+    size_type get_task_size_running() const
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        return unfinished_task_size - __queued();
+    }
+
+    template <typename T1, typename T2, typename TaskLoop>
+    void parallelize(T1 first_index, T2 index_after_last, const TaskLoop &task_loop, size_type num_blocks = 0)
+    {
+        parallelize(first_index, index_after_last, task_loop, multiprocessing::schedule::blocks(num_blocks));
+    }
+
+    template <typename T1, typename T2, typename TaskLoop>
+    void parallelize(T1 first_index, T2 index_after_last, const TaskLoop &task_loop,
+                     const multiprocessing::schedule &policy)
+    {
+        batch_future blocks = submit_range(first_index, index_after_last, std::cref(task_loop), policy);
+        wait(blocks);
+        blocks.get();
+    }
+
+    /**
+     * @brief Split [first_index, index_after_last) into num_blocks blocks (the worker size by default) and queue one
+     * task_loop(start, end) call per block, all at once. Does not wait, the loop is copied once for the whole batch.
+     *
+     * @return A single handle that is ready once every block has finished.
+     */
+    template <typename T1, typename T2, typename TaskLoop>
+    batch_future submit_range(T1 first_index, T2 index_after_last, const TaskLoop &task_loop, size_type num_blocks = 0)
+    {
+        return submit_range(first_index, index_after_last, task_loop, multiprocessing::schedule::blocks(num_blocks));
+    }
+
+    /**
+     * @brief Queue task_loop(start, end) calls covering [first_index, index_after_last) as laid out by the schedule.
+     *
+     * @return A single handle that is ready once the whole range has been processed.
+     */
+    template <typename T1, typename T2, typename TaskLoop>
+    batch_future submit_range(T1 first_index, T2 index_after_last, const TaskLoop &task_loop,
+                              const multiprocessing::schedule &policy)
+    {
+        typedef std::common_type_t<T1, T2> T;
+        T the_first_index = (T)first_index;
+        T last_index = (T)index_after_last;
+        if (the_first_index == last_index) return batch_future(new batch_future::state(0), 0);
+        if (last_index < the_first_index) {
+            T temp = last_index;
+            last_index = the_first_index;
+            the_first_index = temp;
+        }
+        last_index--;
+        size_t total_size = (size_t)(last_index - the_first_index + 1);
+        if (policy.kind != multiprocessing::schedule::STATIC) {
+            return __submit_claims<T>(the_first_index, total_size, task_loop, policy);
+        }
+        size_type num_blocks = policy.chunk > 0 ? (size_type)policy.chunk : std::max<size_type>(concurrency, 1);
+        size_t block_size = (size_t)(total_size / num_blocks);
+        if (block_size == 0) {
+            block_size = 1;
+            num_blocks = (unsigned int)total_size > 1 ? (unsigned int)total_size : 1;
+        }
+
+        struct range_state : batch_future::state {
+            range_state(size_t size, const TaskLoop &loop) : batch_future::state(size), loop(loop) {}
+            TaskLoop loop;
+        };
+        auto *s = new range_state(num_blocks, task_loop);
+        __push_batch(num_blocks, [&](size_type t) {
+            T start = ((T)(t * block_size) + the_first_index);
+            T end = (t == num_blocks - 1) ? last_index + 1 : ((T)((t + 1) * block_size) + the_first_index);
+            auto block = [s, start, end] {
+                s->loop(start, end);
+            };
+            return batch_future::task<decltype(block)>(s, std::move(block));
+        });
+        return batch_future(s, num_blocks);
+    }
+
+    /**
+     * @brief Queue every callable of [first, last) under one lock acquisition (or one reservation of the lock free
+     * ring), and wake at most as many idle workers as there are tasks. The callables are moved from.
+     *
+     * @return A single handle that is ready once every task has finished.
+     */
+    template <typename Iterator>
+    batch_future push_batch(Iterator first, Iterator last)
+    {
+        typedef std::decay_t<decltype(*first)> Task;
+        size_type size = (size_type)std::distance(first, last);
+        auto *s = new batch_future::state(size);
+        __push_batch(size, [&](size_type) {
+            return batch_future::task<Task>(s, std::move(*first++));
+        });
+        return batch_future(s, size);
+    }
+
+    template <typename Task>
+    void push(Task &&task)
+    {
+        if constexpr (!__is_timed<std::decay_t<Task>>::value) {
+            if (instrumented.load(std::memory_order_relaxed) || elastic_max != 0) {
+                push(timed_task<std::decay_t<Task>>{this, std::chrono::steady_clock::now(), std::forward<Task>(task)});
+                __grow_if_stalled();
+                return;
+            }
+        }
+        unfinished_task_size++;
+        if constexpr (strategy == WORK_STEALING) {
+            if (local_pool == this) {
+                queues[local_index].push(new task_type(std::forward<Task>(task)));
+                __notify();
+                return;
+            }
+        }
+        if constexpr (strategy == LOCK_FREE) {
+            task_type item(std::forward<Task>(task));
+            while (!task_ring.try_push(std::move(item))) {
+                if (local_pool == this) {
+                    // full, a worker runs it rather than block: the workers may be the only consumers
+                    __run_inline(item);
+                    return;
+                }
+                __wait_for_space();
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (idle_workers != 0) {
+                atomic_unpark(wakeups, 1);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            std::queue<task_type> &queue = __injection_queue();
+            queue.emplace(std::forward<Task>(task));
+            injected_task_size++;
+            __compact_if_grown(queue);
+        }
+        if constexpr (strategy == CONDITION_VARIABLE) {
+            queue_cond.notify_one();
+        }
+        if constexpr (strategy == WORK_STEALING) {
+            __notify();
+        }
+    }
+
+    /**
+     * @brief Push task once delay has elapsed. A single timer thread, started on first use, keeps the delayed tasks
+     * in a timing wheel of timer_resolution ticks and pushes each one when due, so delayed and periodic tasks cost no
+     * thread of their own. Timers still pending when the pool is destroyed are dropped.
+     */
+    template <typename Task>
+    timer_handle schedule_after(std::chrono::nanoseconds delay, Task &&task)
+    {
+        return __schedule_timer(delay, std::chrono::nanoseconds(0), std::forward<Task>(task));
+    }
+
+    /**
+     * @brief Push task every period, the first time one period from now. Runs are due at fixed multiples of the period
+     * and never overlap: a period that comes while the previous run is still queued or running is skipped.
+     */
+    template <typename Task>
+    timer_handle schedule_every(std::chrono::nanoseconds period, Task &&task)
+    {
+        return __schedule_timer(period, period, std::forward<Task>(task));
+    }
+
+    size_t get_timer_size()
+    {
+        std::lock_guard<std::mutex> guard(timer_lock);
+        return timers.size();
+    }
+
+    /**
+     * @brief Push a task by urgency instead of in FIFO order, see priority. A plain ticket task is queued for each
+     * prioritized task, and whichever worker runs a ticket runs the most urgent prioritized task at that moment, so
+     * bulk work pushed into the LOW lane cannot delay interactive work pushed later into the HIGH lane. Tasks pushed
+     * with push() keep their FIFO order with respect to the tickets.
+     */
+    template <typename Task>
+    void push_prioritized(const priority &p, Task &&task)
+    {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(lane_lock);
+            bool timed = p.deadline != std::chrono::steady_clock::time_point::max();
+            lane_heap.push_back({timed ? p.deadline : now + lane_budgets[p.lane], now, lane_sequence++, p.lane, timed,
+                                 task_type(std::forward<Task>(task))});
+            std::push_heap(lane_heap.begin(), lane_heap.end(), __later);
+        }
+        lane_stats[p.lane].queued++;
+        push([this] {
+            __run_prioritized();
+        });
+    }
+
+    template <typename Task, typename... Args>
+    void push(const Task &task, Args... args)
+    {
+        push([task, args...] {
+            task(args...);
+        });
+    }
+
+    template <typename T, typename... Args, void (T::*Task)(Args...)>
+    void push(typename T::Task *task, Args... args)
+    {
+        push([task, args...] {
+            task(args...);
+        });
+    }
+
+    /* tasks whose first parameter is a stop_token get one, to poll for task_future::cancel() while running */
+    template <typename Task, typename... Args>
+    static constexpr bool __takes_stop_token =
+        std::is_invocable_v<const std::decay_t<Task> &, stop_token, const std::decay_t<Args> &...>;
+
+    template <typename Task, typename... Args>
+    using __result_t = typename std::conditional_t<
+        __takes_stop_token<Task, Args...>,
+        std::invoke_result<const std::decay_t<Task> &, stop_token, const std::decay_t<Args> &...>,
+        std::invoke_result<const std::decay_t<Task> &, const std::decay_t<Args> &...>>::type;
+
+    /**
+     * @brief Submit a function with zero or more arguments and no return value into the task queue, and get a
+     * task_future<bool> that will be set to true upon completion of the task. A function taking a stop_token first
+     * gets the token of the returned future, see task_future::cancel().
+     *
+     * @tparam Task The type of the function.
+     * @tparam Args The types of the zero or more arguments to pass to the function.
+     * @param task The function to submit.
+     * @param args The zero or more arguments to pass to the function.
+     * @return A future to be used later to check if the function has finished its execution.
+     */
+    template <typename Task, typename... Args, typename = std::enable_if_t<std::is_void_v<__result_t<Task, Args...>>>>
+    task_future<bool> submit(const Task &task, const Args &...args)
+    {
+        if constexpr (__takes_stop_token<Task, Args...>) {
+            return __submit<bool>([task, args...](stop_token token) {
+                task(token, args...);
+                return true;
+            });
+        } else {
+            return __submit<bool>([task, args...] {
+                task(args...);
+                return true;
+            });
+        }
+    }
+
+    /**
+     * @brief Submit a function with zero or more arguments and a return value into the task queue, and get a future for
+     * its eventual returned value. A function taking a stop_token first gets the token of the returned future.
+     *
+     * @tparam Task The type of the function.
+     * @tparam Args The types of the zero or more arguments to pass to the function.
+     * @tparam Result The return type of the function.
+     * @param task The function to submit.
+     * @param args The zero or more arguments to pass to the function.
+     * @return A future to be used later to obtain the function's returned value, waiting for it to finish its execution
+     * if needed.
+     */
+    template <typename Task, typename... Args, typename Result = __result_t<Task, Args...>,
+              typename = std::enable_if_t<!std::is_void_v<Result>>>
+    task_future<Result> submit(const Task &task, const Args &...args)
+    {
+        if constexpr (__takes_stop_token<Task, Args...>) {
+            return __submit<Result>([task, args...](stop_token token) {
+                return task(token, args...);
+            });
+        } else {
+            return __submit<Result>([task, args...] {
+                return task(args...);
+            });
+        }
+    }
+
+    template <typename Result, typename F>
+    task_future<Result> __submit(F &&f)
+    {
+        auto [future, job] = task_future<Result>::make(std::forward<F>(f));
+        push(std::move(job));
+        return std::move(future);
+    }
+
+#if defined(THREADPOOL_COROUTINES)
+    /**
+     * @brief co_await pool.schedule() suspends the calling coroutine and resumes it on a worker.
+     */
+    auto schedule()
+    {
+        struct awaiter {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> awaiting)
+            {
+                pool->push([awaiting] {
+                    awaiting.resume();
+                });
+            }
+            void await_resume() const noexcept {}
+            threadpool *pool;
+        };
+        return awaiter{this};
+    }
+#endif
+
+  public:
+    void __worker(size_type index)
+    {
+        local_pool = this;
+        local_index = index;
+        if constexpr (strategy == WORK_STEALING) {
+            while (true) {
+                task_type task;
+                if ((!paused || stopped) && __acquire(task)) {
+                    task();
+                    __finish_task();
+                    continue;
+                }
+                if (stopped) {
+                    break;
+                }
+
+                std::unique_lock<std::mutex> lock(queue_lock);
+                idle_workers++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                bool woken = __idle_wait(lock, [this] {
+                    return stopped || (!paused && __queued() != 0);
+                });
+                idle_workers--;
+                if (!woken && __retire(index)) {
+                    return;
+                }
+            }
+            local_pool = nullptr;
+        } else if constexpr (strategy == LOCK_FREE) {
+            while (true) {
+                task_type task;
+                if ((!paused || stopped) && task_ring.try_pop(task)) {
+                    __space_freed();
+                    task();
+                    __finish_task();
+                    continue;
+                }
+                if (stopped) {
+                    break;
+                }
+
+                idle_workers++;
+                uint32_t seen = wakeups.load();
+                bool woken = true;
+                if (!stopped && (paused || task_ring.empty())) {
+                    if (elastic_max == 0) {
+                        atomic_park(wakeups, seen);
+                    } else {
+                        woken = atomic_park_for(wakeups, seen, elastic_idle_timeout);
+                    }
+                }
+                idle_workers--;
+                if (!woken && __retire(index)) {
+                    return;
+                }
+            }
+        } else if constexpr (strategy == CONDITION_VARIABLE) {
+            while (true) {
+                task_type task;
+                {
+                    std::unique_lock<std::mutex> lock(queue_lock);
+                    idle_workers++;
+                    bool woken = __idle_wait(lock, [this] {
+                        return stopped || (!paused && !task_queue.empty());
+                    });
+                    idle_workers--;
+                    if (stopped && task_queue.empty()) {
+                        return;
+                    }
+                    if (!woken) {
+                        if (__retire(index)) {
+                            return;
+                        }
+                        continue;
+                    }
+
+                    task = std::move(task_queue.front());
+                    task_queue.pop();
+                    injected_task_size--;
                 }
 
                 task();
-                unfinished_task_size--;
+                __finish_task();
             }
         } else {
+            auto idle_since = std::chrono::steady_clock::time_point::min();
             while (!stopped) {
-                auto pop_task = [&](std::function<void()> &task) {
+                auto pop_task = [&](task_type &task) {
                     std::lock_guard<std::mutex> guard(queue_lock);
                     if (paused || task_queue.empty()) {
                         return false;
                     } else {
                         task = std::move(task_queue.front());
                         task_queue.pop();
+                        injected_task_size--;
                         return true;
                     }
                 };
 
-                std::function<void()> task;
+                task_type task;
                 if (pop_task(task)) {
+                    idle_since = std::chrono::steady_clock::time_point::min();
                     task();
-                    unfinished_task_size--;
+                    __finish_task();
                 } else {
+                    idle_workers++;
                     if (duration == 0) {
                         std::this_thread::yield();
                     } else {
                         std::this_thread::sleep_for(std::chrono::microseconds(duration));
                     }
+                    idle_workers--;
+                    if (elastic_max != 0) {
+                        auto now = std::chrono::steady_clock::now();
+                        if (idle_since == std::chrono::steady_clock::time_point::min()) {
+                            idle_since = now;
+                        } else if (now - idle_since >= elastic_idle_timeout && __retire(index)) {
+                            return;
+                        }
+                    }
                 }
             }
         }
@@ -431,14 +2284,749 @@ class threadpool {
                     if (duration == 0) {
                         std::this_thread::yield();
                     } else {
-                        std::this_thread::sleep_for(std::chrono::microseconds(duration));
+                        std::this_thread::sleep_for(std::chrono::microseconds(duration));
+                    }
+                } else {
+                    return;
+                }
+            }
+        }
+#endif
+    }
+
+    /* queued tasks, including the ones in worker deques */
+    size_type __queued() const
+    {
+        size_type size = injected_task_size;
+        if constexpr (strategy == LOCK_FREE) {
+            size += (size_type)task_ring.size();
+        }
+        if constexpr (strategy == WORK_STEALING) {
+            for (size_type i = 0; i < capacity; i++) {
+                size += (size_type)queues[i].size();
+            }
+        }
+        return size;
+    }
+
+    /* own deque first (LIFO), then the shared queue of our node, then steal (FIFO) from a random victim of our node,
+     * then the same from the other nodes */
+    bool __acquire(task_type &task)
+    {
+        auto take = [&task](task_type *item) {
+            task = std::move(*item);
+            delete item;
+            return true;
+        };
+        bool owner = (local_pool == this);
+        if (owner) {
+            if (auto *item = queues[local_index].pop()) {
+                return take(item);
+            }
+        }
+        const node_map &map = *nodes.load(std::memory_order_acquire);
+        size_type node = __current_node();
+        auto take_injected = [&](bool local) {
+            if (injected_task_size == 0) {
+                return false;
+            }
+            std::lock_guard<std::mutex> guard(queue_lock);
+            size_type count = nodes.load(std::memory_order_acquire)->count;
+            for (size_type i = 0; i < count; i++) {
+                std::queue<task_type> &queue = node_queues[(node + i) % count];
+                if (!queue.empty() && (i == 0) == local) {
+                    task = std::move(queue.front());
+                    queue.pop();
+                    injected_task_size--;
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if (capacity == 0) {
+            return take_injected(true) || take_injected(false);
+        }
+        static thread_local uint32_t seed = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;
+        for (bool local : {true, false}) {
+            if (take_injected(local)) {
+                return true;
+            }
+            for (size_type i = 0, start = seed % capacity; i < capacity; i++) {
+                size_type victim = (start + i) % capacity;
+                if ((owner && victim == local_index) || (map.workers[victim] == node) != local) {
+                    continue;
+                }
+                if (auto *item = queues[victim].steal()) {
+                    __add(owner ? counters[local_index].steals : counters[capacity].steals, 1, !owner);
+                    return take(item);
+                }
+            }
+            if (map.count == 1) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    /* the shared queue that push() feeds, per node of the calling thread with work stealing */
+    std::queue<task_type> &__injection_queue()
+    {
+        if constexpr (strategy == WORK_STEALING) {
+            return node_queues[__current_node()];
+        }
+        return task_queue;
+    }
+
+    size_type __current_node() const
+    {
+        const node_map &map = *nodes.load(std::memory_order_acquire);
+        if (map.count == 1) {
+            return 0;
+        }
+        if (local_pool == this) {
+            return map.workers[local_index];
+        }
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && cpu < (int)map.cpus.size()) {
+            return map.cpus[cpu];
+        }
+#endif
+        return 0;
+    }
+
+    /* build the node map of the topology for the current slots and publish it, with work stealing together with
+     * one shared queue per node */
+    void __publish_nodes()
+    {
+        auto map = std::make_unique<node_map>();
+        if constexpr (strategy == WORK_STEALING) {
+            map->count = std::max<size_type>(1, (size_type)topology.nodes.size());
+        }
+        for (size_type node = 0; node < (size_type)topology.nodes.size(); node++) {
+            for (int cpu : topology.nodes[node]) {
+                if (cpu >= (int)map->cpus.size()) map->cpus.resize(cpu + 1, 0);
+                map->cpus[cpu] = std::min(node, map->count - 1);
+            }
+        }
+        map->workers.resize(capacity);
+        for (size_type i = 0; i < capacity; i++) {
+            map->workers[i] = std::min(get_worker_node(i), map->count - 1);
+        }
+
+        std::lock_guard<std::mutex> guard(queue_lock);
+        if constexpr (strategy == WORK_STEALING) {
+            const node_map *old = nodes.load(std::memory_order_relaxed);
+            std::unique_ptr<std::queue<task_type>[]> fresh(new std::queue<task_type>[map->count]);
+            for (size_type node = 0; node < (old ? old->count : 1); node++) {
+                while (!node_queues[node].empty()) {
+                    fresh[0].push(std::move(node_queues[node].front()));
+                    node_queues[node].pop();
+                }
+            }
+            node_queues = std::move(fresh);
+        }
+        nodes.store(map.get(), std::memory_order_release);
+        node_maps.push_back(std::move(map));
+    }
+
+    bool __pin_worker(size_type worker, const std::vector<int> &cpus)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(workers[worker].native_handle(), sizeof(set), &set) == 0;
+#else
+        (void)worker, (void)cpus;
+        return false;
+#endif
+    }
+
+    /* a task pushed while instrumented, carrying its push time */
+    template <typename F>
+    struct timed_task {
+        threadpool *pool;
+        std::chrono::steady_clock::time_point pushed;
+        F fn;
+
+        void operator()()
+        {
+            pool->__run_timed(pushed, fn);
+        }
+
+        template <typename G = F>
+        auto cancelled() const noexcept -> decltype(std::declval<const G &>().cancelled())
+        {
+            return fn.cancelled();
+        }
+    };
+
+    template <typename T>
+    struct __is_timed : std::false_type {
+    };
+    template <typename F>
+    struct __is_timed<timed_task<F>> : std::true_type {
+    };
+
+    /* one cache line aligned block per worker, written only by that worker, plus one shared by all other threads */
+    struct alignas(64) worker_counters {
+        std::atomic<uint64_t> executed, busy_ns, steals, latency_sum, latency_max, runtime_max;
+        std::atomic<uint64_t> latency[log_histogram::bucket_count];
+        std::atomic<uint64_t> runtime[log_histogram::bucket_count];
+
+        void clear()
+        {
+            for (auto *c : {&executed, &busy_ns, &steals, &latency_sum, &latency_max, &runtime_max}) {
+                c->store(0, std::memory_order_relaxed);
+            }
+            for (size_t b = 0; b < log_histogram::bucket_count; b++) {
+                latency[b].store(0, std::memory_order_relaxed);
+                runtime[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /* a worker's own counters need no locked instruction, the shared ones do */
+    static void __add(std::atomic<uint64_t> &counter, uint64_t value, bool shared)
+    {
+        if (shared) {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        } else {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    static void __raise(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+        uint64_t current = counter.load(std::memory_order_relaxed);
+        while (value > current && !counter.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    template <typename F>
+    void __run_timed(std::chrono::steady_clock::time_point pushed, F &fn)
+    {
+        bool shared = local_pool != this;
+        worker_counters &c = counters[shared ? capacity : local_index];
+        auto start = std::chrono::steady_clock::now();
+        uint64_t waited = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(start - pushed).count();
+        __add(c.latency[log_histogram::index_of(waited)], 1, shared);
+        __add(c.latency_sum, waited, shared);
+        __raise(c.latency_max, waited);
+        auto record_run = [&] {
+            uint64_t ran = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+            __add(c.runtime[log_histogram::index_of(ran)], 1, shared);
+            __add(c.busy_ns, ran, shared);
+            __add(c.executed, 1, shared);
+            __raise(c.runtime_max, ran);
+        };
+        if (elastic_max != 0) {
+            last_start.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+            if (std::chrono::nanoseconds(waited) > elastic_spawn_latency && idle_workers == 0) {
+                __spawn();
+            }
+        }
+        try {
+            fn();
+        } catch (...) {
+            record_run();
+            throw;
+        }
+        record_run();
+    }
+
+    /* under queue_lock, once a shared queue has doubled since the last pass, drop its cancelled tasks: O(1) amortized
+     * per push. Cancelled tasks still queued in between are skipped when popped */
+    void __compact_if_grown(std::queue<task_type> &queue)
+    {
+        if (queue.size() < compact_at) {
+            return;
+        }
+        std::queue<task_type> kept;
+        size_type dropped = 0;
+        for (; !queue.empty(); queue.pop()) {
+            if (queue.front().cancelled()) {
+                dropped++;
+            } else {
+                kept.push(std::move(queue.front()));
+            }
+        }
+        queue.swap(kept);
+        compact_at = std::max<size_t>(compact_min, 2 * queue.size());
+        injected_task_size -= dropped;
+        while (dropped-- != 0) {
+            __finish_task();
+        }
+    }
+
+    /* tick of the timing wheel for now, counted from the start of the timer thread */
+    uint64_t __timer_now() const
+    {
+        return (uint64_t)((std::chrono::steady_clock::now() - timer_epoch) / timer_resolution);
+    }
+
+    template <typename Task>
+    timer_handle __schedule_timer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period, Task &&task)
+    {
+        auto job = std::make_shared<timer_job>();
+        job->fn = task_type(std::forward<Task>(task));
+        job->period = period.count() > 0 ? std::max<uint64_t>(1, (uint64_t)(period / timer_resolution)) : 0;
+        {
+            std::lock_guard<std::mutex> guard(timer_lock);
+            if (!timer_thread.joinable()) {
+                timer_epoch = std::chrono::steady_clock::now();
+                timer_thread = std::thread(&threadpool::__timer_loop, this);
+            }
+            // round up, a task never runs early
+            auto ticks = (uint64_t)((delay + timer_resolution - std::chrono::nanoseconds(1)) / timer_resolution);
+            uint64_t now = __timer_now();
+            if (timers.size() == 0) {
+                timers.advance(now, [](std::shared_ptr<timer_job> &&) {}); // catch up after sleeping with no timers
+            }
+            job->due = now + std::max<uint64_t>(ticks, 1);
+            timers.insert(job->due, job);
+        }
+        timer_cond.notify_one();
+        return timer_handle(job);
+    }
+
+    void __timer_loop()
+    {
+        std::vector<std::shared_ptr<timer_job>> due;
+        std::unique_lock<std::mutex> lock(timer_lock);
+        while (!timer_stopping) {
+            uint64_t now = __timer_now();
+            timers.advance(now, [&due](std::shared_ptr<timer_job> &&job) {
+                due.push_back(std::move(job));
+            });
+            for (auto &job : due) {
+                if (job->period != 0 && !job->cancelled) {
+                    uint64_t behind = (now - job->due) / job->period;
+                    job->skipped += behind;
+                    job->due += (behind + 1) * job->period;
+                    timers.insert(job->due, job);
+                }
+            }
+            // push outside the lock: a task may schedule timers, and push() can run it inline
+            lock.unlock();
+            for (auto &job : due) {
+                if (job->cancelled) {
+                    continue;
+                }
+                if (job->running.exchange(true)) {
+                    job->skipped++;
+                    continue;
+                }
+                job->fired++;
+                push([job] {
+                    struct done {
+                        ~done()
+                        {
+                            job->running = false;
+                        }
+                        timer_job *job;
+                    } guard{job.get()};
+                    job->fn();
+                });
+            }
+            due.clear();
+            lock.lock();
+            uint64_t next = timers.next_expiry();
+            if (timer_stopping) {
+                break;
+            }
+            if (next == UINT64_MAX) {
+                timer_cond.wait(lock);
+            } else {
+                timer_cond.wait_until(lock, timer_epoch + (int64_t)next * timer_resolution);
+            }
+        }
+    }
+
+    void __stop_timers()
+    {
+        {
+            std::lock_guard<std::mutex> guard(timer_lock);
+            timer_stopping = true;
+        }
+        timer_cond.notify_one();
+        if (timer_thread.joinable()) {
+            timer_thread.join();
+        }
+    }
+
+    /* (re)create the worker slots with the first live ones running, keeping the placement */
+    void __start(size_type slots, size_type live)
+    {
+        stopped = false;
+        capacity = slots;
+        concurrency = live;
+        workers.reset(new std::thread[slots]);
+        alive.reset(new std::atomic<bool>[slots]);
+        if constexpr (strategy == WORK_STEALING) {
+            queues.reset(new chase_lev_deque<task_type>[slots]);
+        }
+        __publish_nodes(); // sized for the new slots before any worker reads it
+        __reset_counters();
+        last_start = std::chrono::steady_clock::now().time_since_epoch().count();
+        for (size_type i = 0; i < slots; i++) {
+            alive[i] = i < live;
+        }
+        for (size_type i = 0; i < live; i++) {
+            workers[i] = std::thread(&threadpool::__worker, this, i);
+        }
+        if (!topology.nodes.empty()) {
+            place(topology, pin_nodes);
+        } else if (!pinned_cpus.empty()) {
+            pin(pinned_cpus);
+        }
+    }
+
+    /* wait on queue_cond, for at most the idle timeout in elastic mode; false if that timed out */
+    template <typename Predicate>
+    bool __idle_wait(std::unique_lock<std::mutex> &lock, Predicate ready)
+    {
+        if (elastic_max == 0) {
+            queue_cond.wait(lock, ready);
+            return true;
+        }
+        return queue_cond.wait_for(lock, elastic_idle_timeout, ready);
+    }
+
+    /* start a worker in a free slot, if the pool may grow */
+    void __spawn()
+    {
+        std::lock_guard<std::mutex> guard(elastic_lock);
+        if (stopped || concurrency >= elastic_max) {
+            return;
+        }
+        for (size_type i = 0; i < capacity; i++) {
+            if (!alive[i]) {
+                if (workers[i].joinable()) {
+                    workers[i].join(); // retired, about to return
+                }
+                alive[i] = true;
+                concurrency++;
+                // the start counts as progress, so that a burst of pushes adds one worker per spawn_latency
+                last_start = std::chrono::steady_clock::now().time_since_epoch().count();
+                workers[i] = std::thread(&threadpool::__worker, this, i);
+                if (!topology.nodes.empty() && pin_nodes) {
+                    __pin_worker(i, topology.nodes[get_worker_node(i)]);
+                } else if (!pinned_cpus.empty()) {
+                    __pin_worker(i, {pinned_cpus[i % pinned_cpus.size()]});
+                }
+                return;
+            }
+        }
+    }
+
+    /* an idle worker leaves if the pool may shrink, its slot can be reused by __spawn() */
+    bool __retire(size_type index)
+    {
+        std::lock_guard<std::mutex> guard(elastic_lock);
+        if (stopped || elastic_max == 0 || concurrency <= elastic_min) {
+            return false;
+        }
+        concurrency--;
+        alive[index] = false;
+        return true;
+    }
+
+    /* all workers busy and no task started for spawn_latency: the queue is stuck behind long tasks */
+    void __grow_if_stalled()
+    {
+        if (elastic_max == 0 || concurrency >= elastic_max || idle_workers != 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        if (std::chrono::steady_clock::duration(now - last_start.load(std::memory_order_relaxed))
+            > elastic_spawn_latency) {
+            __spawn();
+        }
+    }
+
+    void __reset_counters()
+    {
+        counters.reset(new worker_counters[capacity + 1]);
+        for (size_type i = 0; i <= capacity; i++) counters[i].clear();
+        counters_since = std::chrono::steady_clock::now();
+    }
+
+    /* queue one task per worker that claims chunks of [first, first + total_size) until none is left */
+    template <typename T, typename TaskLoop>
+    batch_future __submit_claims(T first, size_t total_size, const TaskLoop &task_loop,
+                                 const multiprocessing::schedule &policy)
+    {
+        size_t chunk = policy.chunk > 0 ? policy.chunk : 1;
+        size_type claimers = std::max<size_type>(concurrency, 1);
+        if (claimers > (total_size + chunk - 1) / chunk) claimers = (size_type)((total_size + chunk - 1) / chunk);
+
+        struct claim_state : batch_future::state {
+            claim_state(size_t size, const TaskLoop &loop) : batch_future::state(size), loop(loop) {}
+            TaskLoop loop;
+            T first;
+            size_t total, chunk, claimers;
+            bool guided;
+            std::atomic<size_t> next = 0;
+
+            void run()
+            {
+                while (true) {
+                    size_t begin, size = chunk;
+                    if (guided) {
+                        begin = next.load(std::memory_order_relaxed);
+                        do {
+                            if (begin >= total) return;
+                            size = std::max(chunk, (total - begin) / (2 * claimers));
+                        } while (!next.compare_exchange_weak(begin, begin + size, std::memory_order_relaxed));
+                    } else {
+                        begin = next.fetch_add(chunk, std::memory_order_relaxed);
+                        if (begin >= total) return;
+                    }
+                    size_t end = std::min(begin + size, total);
+                    loop((T)(first + (T)begin), (T)(first + (T)end));
+                }
+            }
+        };
+        auto *s = new claim_state(claimers, task_loop);
+        s->first = first;
+        s->total = total_size;
+        s->chunk = chunk;
+        s->claimers = claimers;
+        s->guided = policy.kind == multiprocessing::schedule::GUIDED;
+        __push_batch(claimers, [&](size_type) {
+            auto claim = [s] {
+                s->run();
+            };
+            return batch_future::task<decltype(claim)>(s, std::move(claim));
+        });
+        return batch_future(s, claimers);
+    }
+
+    struct prioritized_task {
+        std::chrono::steady_clock::time_point deadline, pushed;
+        uint64_t sequence;
+        priority::lane_type lane;
+        bool timed;
+        task_type task;
+    };
+
+    struct lane_counters {
+        std::atomic<size_t> queued = 0, executed = 0, missed = 0;
+        std::atomic<int64_t> total_latency_ns = 0, max_latency_ns = 0;
+    };
+
+    /* heap order: the earliest deadline on top, pushed first among equals */
+    static bool __later(const prioritized_task &a, const prioritized_task &b)
+    {
+        return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+    }
+
+    /* the body of every ticket queued by push_prioritized() */
+    void __run_prioritized()
+    {
+        prioritized_task next;
+        {
+            std::lock_guard<std::mutex> guard(lane_lock);
+            std::pop_heap(lane_heap.begin(), lane_heap.end(), __later);
+            next = std::move(lane_heap.back());
+            lane_heap.pop_back();
+        }
+        auto now = std::chrono::steady_clock::now();
+        int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - next.pushed).count();
+        lane_counters &c = lane_stats[next.lane];
+        c.queued--;
+        c.executed++;
+        c.total_latency_ns += latency;
+        int64_t max = c.max_latency_ns.load(std::memory_order_relaxed);
+        while (latency > max && !c.max_latency_ns.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {
+        }
+        if (next.timed && now > next.deadline) {
+            c.missed++;
+        }
+        next.task();
+    }
+
+    /* run one queued task on the calling thread, returns false if there was none */
+    bool __run_pending()
+    {
+        task_type task;
+        if constexpr (strategy == WORK_STEALING) {
+            if (!__acquire(task)) {
+                return false;
+            }
+        } else if constexpr (strategy == LOCK_FREE) {
+            if (!task_ring.try_pop(task)) {
+                return false;
+            }
+            __space_freed();
+        } else {
+            if (injected_task_size == 0) {
+                return false;
+            }
+            std::lock_guard<std::mutex> guard(queue_lock);
+            if (task_queue.empty()) {
+                return false;
+            }
+            task = std::move(task_queue.front());
+            task_queue.pop();
+            injected_task_size--;
+        }
+        __run_inline(task);
+        return true;
+    }
+
+    /* run a task of this pool on the calling thread, recorded so that a wait() inside it does not wait for itself */
+    void __run_inline(task_type &task)
+    {
+        inline_frame frame{this, local_inline};
+        local_inline = &frame;
+        task();
+        local_inline = frame.next;
+        __finish_task();
+    }
+
+    /* number of unfinished tasks of this pool that are running on the calling thread */
+    size_type __running_here() const
+    {
+        size_type count = local_pool == this ? 1 : 0;
+        for (auto frame = local_inline; frame; frame = frame->next) {
+            count += frame->pool == this;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Park a producer that is not a worker of this pool while the ring is full, until a worker frees a slot.
+     * The timeout bounds a wakeup missed between the last try and parking, as __space_freed() does not fence.
+     */
+    void __wait_for_space()
+    {
+        // a batch wakes the workers once it is queued, they have to drain the ring before that
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle_workers != 0) {
+            atomic_unpark(wakeups, INT_MAX);
+        }
+        space_waiters++;
+        uint32_t seen = ring_space.load();
+        if (task_ring.size() >= task_ring.capacity()) {
+            atomic_park_for(ring_space, seen, std::chrono::milliseconds(1));
+        }
+        space_waiters--;
+    }
+
+    void __space_freed()
+    {
+        if (space_waiters.load(std::memory_order_relaxed) != 0) {
+            atomic_unpark(ring_space, 1);
+        }
+    }
+
+    void __finish_task()
+    {
+        if (--unfinished_task_size == 0 && waiters != 0) {
+            atomic_unpark(drained, INT_MAX);
+        }
+    }
+
+    void __notify(size_type count = 1)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_type idle = idle_workers;
+        if (idle != 0) {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            if (count >= idle) {
+                queue_cond.notify_all();
+            } else {
+                for (size_type i = 0; i < count; i++) {
+                    queue_cond.notify_one();
+                }
+            }
+        }
+    }
+
+    /* queue make(0) ... make(size - 1) at once, then wake min(size, idle) workers */
+    template <typename Make>
+    void __push_batch(size_type size, Make &&make)
+    {
+        if (size == 0) {
+            return;
+        }
+        typedef std::decay_t<decltype(make(0))> Task;
+        if constexpr (!__is_timed<Task>::value) {
+            if (instrumented.load(std::memory_order_relaxed) || elastic_max != 0) {
+                auto pushed = std::chrono::steady_clock::now();
+                __push_batch(size, [&](size_type i) {
+                    return timed_task<Task>{this, pushed, make(i)};
+                });
+                __grow_if_stalled();
+                return;
+            }
+        }
+        unfinished_task_size += size;
+        if constexpr (strategy == WORK_STEALING) {
+            if (local_pool == this) {
+                for (size_type i = 0; i < size; i++) {
+                    queues[local_index].push(new task_type(make(i)));
+                }
+                __notify(size);
+                return;
+            }
+        }
+        if constexpr (strategy == LOCK_FREE) {
+            size_type i = 0;
+            while (i < size) {
+                size_t pushed = task_ring.try_push_n(size - i, [&] {
+                    return task_type(make(i++));
+                });
+                if (pushed == 0) {
+                    if (local_pool == this) {
+                        // full, a worker runs one and retries, the workers are busy anyway
+                        task_type task(make(i++));
+                        __run_inline(task);
+                    } else {
+                        __wait_for_space();
                     }
-                } else {
-                    return;
                 }
             }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            size_type idle = idle_workers;
+            if (idle != 0) {
+                atomic_unpark(wakeups, (int)std::min(size, idle));
+            }
+            return;
+        }
+        size_type idle;
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            std::queue<task_type> &queue = __injection_queue();
+            for (size_type i = 0; i < size; i++) {
+                queue.emplace(make(i));
+            }
+            injected_task_size += size;
+            __compact_if_grown(queue);
+            idle = idle_workers;
+        }
+        if constexpr (strategy == CONDITION_VARIABLE) {
+            if (size >= idle) {
+                queue_cond.notify_all();
+            } else {
+                for (size_type i = 0; i < size; i++) {
+                    queue_cond.notify_one();
+                }
+            }
+        }
+        if constexpr (strategy == WORK_STEALING) {
+            __notify(size);
         }
-#endif
     }
 
     /**
@@ -451,13 +3039,770 @@ class threadpool {
 
     size_t duration;
 
-    size_type concurrency;
+    size_type capacity = 0;                   /* worker slots */
+    std::atomic<size_type> concurrency = 0;   /* running workers, fewer than the slots only in elastic mode */
     std::unique_ptr<std::thread[]> workers;
+    std::unique_ptr<std::atomic<bool>[]> alive; /* slots with a running worker */
+
+    /* elastic mode, see elastic(): disabled while elastic_max is 0. last_start is the last task start, in steady
+     * clock ticks */
+    std::mutex elastic_lock;
+    size_type elastic_min = 0, elastic_max = 0;
+    std::chrono::nanoseconds elastic_spawn_latency{0}, elastic_idle_timeout{0};
+    std::atomic<int64_t> last_start = 0;
+
+    /* delayed and periodic tasks, see schedule_after(). due and period are in ticks of timer_resolution */
+    struct timer_job : timer_handle::state {
+        task_type fn;
+        uint64_t due = 0, period = 0;
+        std::atomic<bool> running = false;
+    };
+    static constexpr std::chrono::milliseconds timer_resolution{1};
+    std::mutex timer_lock;
+    std::condition_variable timer_cond;
+    std::thread timer_thread;
+    std::chrono::steady_clock::time_point timer_epoch;
+    timing_wheel<std::shared_ptr<timer_job>> timers;
+    bool timer_stopping = false;
 
     mutable std::mutex queue_lock;
     mutable std::condition_variable queue_cond;
-    std::queue<std::function<void()>> task_queue;
+    std::queue<task_type> task_queue;
+    std::atomic<size_type> injected_task_size = 0; /* size of task_queue, readable without the lock */
+    static constexpr size_t compact_min = 1024;    /* see __compact_if_grown() */
+    size_t compact_at = compact_min;
+
+    /* work stealing: one deque per worker. The worker that the current thread is, if any, for every strategy.
+     * idle_workers counts parked workers of every strategy but yield */
+    std::unique_ptr<chase_lev_deque<task_type>[]> queues;
+    std::atomic<size_type> idle_workers = 0;
+    static inline thread_local const threadpool *local_pool = nullptr;
+    static inline thread_local size_type local_index = 0;
+
+    /* tasks run inline on the current thread by __run_inline(), innermost first */
+    struct inline_frame {
+        const threadpool *pool;
+        inline_frame *next;
+    };
+    static inline thread_local inline_frame *local_inline = nullptr;
+
+    /* placement: the layout and pinning to re-apply after reset(), and with work stealing the shared queue of each
+     * node (replacing task_queue). Workers read the node map without a lock, so a published map is immutable and
+     * kept until the pool is destroyed; node_queues and the map are swapped together under queue_lock */
+    struct node_map {
+        size_type count = 1;            // number of nodes with a queue, 1 but with work stealing
+        std::vector<size_type> cpus;    // node of each cpu id
+        std::vector<size_type> workers; // node of each worker slot
+    };
+    cpu_topology topology;
+    bool pin_nodes = false;
+    std::vector<int> pinned_cpus;
+    std::unique_ptr<std::queue<task_type>[]> node_queues;
+    std::vector<std::unique_ptr<node_map>> node_maps;
+    std::atomic<const node_map *> nodes = nullptr;
+
+    /* instrumentation, see instrument() */
+    std::atomic<bool> instrumented = false;
+    std::unique_ptr<worker_counters[]> counters;
+    std::chrono::steady_clock::time_point counters_since;
+
+    /* lock free: the ring replaces task_queue, parked workers wait for wakeups to change */
+    mpmc_queue<task_type> task_ring;
+    std::atomic<uint32_t> wakeups = 0;
+    std::atomic<uint32_t> ring_space = 0; /* producers parked on a full ring wait for it to change */
+    std::atomic<size_type> space_waiters = 0;
+
+    /* prioritized tasks, run by the tickets that push_prioritized() queues */
+    std::mutex lane_lock;
+    std::vector<prioritized_task> lane_heap;
+    uint64_t lane_sequence = 0;
+    std::chrono::steady_clock::duration lane_budgets[priority::lanes] = {
+        std::chrono::milliseconds(0), std::chrono::milliseconds(10), std::chrono::milliseconds(100)};
+    lane_counters lane_stats[priority::lanes];
 
     std::atomic<size_type> unfinished_task_size; /* number of tasks that not finished, queued or running */
+    std::atomic<size_type> waiters = 0;          /* threads sleeping in wait() */
+    std::atomic<uint32_t> drained = 0;           /* bumped when unfinished_task_size drops to zero */
+};
+
+/**
+ * @brief A graph of tasks where every node declares the nodes it has to run after. run() queues the nodes without
+ * predecessors, and a node that finishes counts down the pending predecessors of each successor, queueing the ones that
+ * become ready. The last ready successor runs on the same worker right away, so no worker ever blocks on another
+ * node. The graph is kept after a run and can be run again, e.g. once per monitoring period; it must not be changed,
+ * run twice at once or destroyed while running. When a node throws, the nodes that have not started yet are skipped
+ * and get() on the handle rethrows the exception.
+ */
+class task_graph {
+  public:
+    typedef size_t node;
+
+    task_graph() = default;
+    task_graph(const task_graph &) = delete;
+    task_graph &operator=(const task_graph &) = delete;
+
+    /**
+     * @brief Add a node that runs work after every node of predecessors.
+     *
+     * @return The new node, to be named as a predecessor of later nodes.
+     */
+    template <typename F>
+    node emplace(F &&work, std::initializer_list<node> predecessors = {})
+    {
+        nodes.emplace_back(std::forward<F>(work));
+        node id = nodes.size() - 1;
+        for (node predecessor : predecessors) {
+            precede(predecessor, id);
+        }
+        validated = false;
+        return id;
+    }
+
+    /* make after wait for before */
+    void precede(node before, node after)
+    {
+        nodes.at(before).successors.push_back(after);
+        nodes.at(after).predecessors++;
+        validated = false;
+    }
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    void clear()
+    {
+        nodes.clear();
+        roots.clear();
+        validated = false;
+    }
+
+    /**
+     * @brief Queue the graph on the pool. Throws std::logic_error if the graph has a cycle.
+     *
+     * @return A handle that is ready once every node has run, see threadpool::wait(const batch_future &).
+     */
+    template <int strategy>
+    batch_future run(threadpool<strategy> &pool)
+    {
+        __validate();
+        auto *s = new run_state<strategy>(this, &pool);
+        for (auto &n : nodes) {
+            n.pending.store(n.predecessors, std::memory_order_relaxed);
+        }
+        for (node root : roots) {
+            pool.push(node_task<strategy>(s, root));
+        }
+        return batch_future(s, nodes.size());
+    }
+
+  private:
+    struct node_data {
+        template <typename F>
+        explicit node_data(F &&work) : work(std::forward<F>(work))
+        {
+        }
+
+        unique_function<void()> work;
+        std::vector<node> successors;
+        size_t predecessors = 0;
+        std::atomic<size_t> pending = 0;
+    };
+
+    template <int strategy>
+    struct run_state : batch_future::state {
+        run_state(task_graph *graph, threadpool<strategy> *pool)
+            : batch_future::state(graph->nodes.size()), graph(graph), pool(pool)
+        {
+        }
+
+        task_graph *graph;
+        threadpool<strategy> *pool;
+        std::atomic<bool> cancelled = false;
+    };
+
+    /* one queued node, skipped along with its successors if destroyed without running */
+    template <int strategy>
+    class node_task {
+      public:
+        node_task(run_state<strategy> *s, node id) : s(s), id(id) {}
+        node_task(node_task &&other) noexcept : s(other.s), id(other.id)
+        {
+            other.s = nullptr;
+        }
+        node_task(const node_task &) = delete;
+        ~node_task()
+        {
+            if (s) {
+                s->cancelled = true;
+                s->fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                s->graph->__complete(s, id, false);
+            }
+        }
+
+        void operator()()
+        {
+            run_state<strategy> *current = s;
+            s = nullptr;
+            current->graph->__complete(current, id, true);
+        }
+
+      private:
+        run_state<strategy> *s;
+        node id;
+    };
+
+    /* run a node, then its ready successors: all but the last are queued when queue_ready is set, the last one (or
+     * all of them, without queue_ready) continues on this thread */
+    template <int strategy>
+    void __complete(run_state<strategy> *s, node id, bool queue_ready)
+    {
+        const node none = nodes.size();
+        while (true) {
+            node_data &n = nodes[id];
+            if (!s->cancelled.load(std::memory_order_relaxed)) {
+                try {
+                    n.work();
+                } catch (...) {
+                    s->cancelled = true;
+                    s->fail(std::current_exception());
+                }
+            }
+            node next = none;
+            for (node successor : n.successors) {
+                if (nodes[successor].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next != none) {
+                        if (queue_ready) {
+                            s->pool->push(node_task<strategy>(s, next));
+                        } else {
+                            __complete(s, next, false);
+                        }
+                    }
+                    next = successor;
+                }
+            }
+            // the graph may be gone once the last node is done, touch only locals after this
+            s->done();
+            s->release();
+            if (next == none) {
+                return;
+            }
+            id = next;
+        }
+    }
+
+    /* collect the roots and reject cycles (Kahn's algorithm), once per change of the graph */
+    void __validate()
+    {
+        if (validated) return;
+        roots.clear();
+        std::vector<size_t> pending(nodes.size());
+        std::vector<node> ready;
+        for (node id = 0; id < nodes.size(); id++) {
+            pending[id] = nodes[id].predecessors;
+            if (pending[id] == 0) {
+                roots.push_back(id);
+                ready.push_back(id);
+            }
+        }
+        size_t visited = 0;
+        while (!ready.empty()) {
+            node id = ready.back();
+            ready.pop_back();
+            visited++;
+            for (node successor : nodes[id].successors) {
+                if (--pending[successor] == 0) ready.push_back(successor);
+            }
+        }
+        if (visited != nodes.size()) {
+            throw std::logic_error("task_graph has a cycle");
+        }
+        validated = true;
+    }
+
+    std::deque<node_data> nodes;
+    std::vector<node> roots;
+    bool validated = false;
+};
+
+/**
+ * @brief Parallel versions of a few standard algorithms on top of threadpool. Every algorithm takes the pool to run on
+ * first, followed by the arguments of its std counterpart, requires random access iterators, and blocks until done
+ * (the calling thread helps, see threadpool::wait(const batch_future &)). Work is cut into one block per worker, an
+ * exception thrown by an element operation is rethrown to the caller.
+ */
+namespace algorithms
+{
+template <int strategy>
+size_t __block_count(const threadpool<strategy> &pool, size_t size)
+{
+    size_t blocks = pool.get_worker_size() > 0 ? pool.get_worker_size() : 1;
+    return std::max<size_t>(1, std::min(blocks, size));
+}
+
+/* run body(block, begin, end) for the blocks of [0, size), in parallel */
+template <int strategy, typename Body>
+void __for_blocks(threadpool<strategy> &pool, size_t size, size_t blocks, const Body &body)
+{
+    pool.parallelize(
+        (size_t)0, blocks,
+        [&](size_t first_block, size_t last_block) {
+            for (size_t b = first_block; b < last_block; b++) {
+                body(b, size * b / blocks, size * (b + 1) / blocks);
+            }
+        },
+        blocks);
+}
+
+template <int strategy, typename Iterator, typename Function>
+void for_each(threadpool<strategy> &pool, Iterator first, Iterator last, Function f,
+              const schedule &policy = schedule::blocks())
+{
+    pool.parallelize(
+        (size_t)0, (size_t)std::distance(first, last),
+        [&](size_t begin, size_t end) {
+            for (Iterator it = first + begin, stop = first + end; it != stop; ++it) {
+                f(*it);
+            }
+        },
+        policy);
+}
+
+template <int strategy, typename InputIterator, typename OutputIterator, typename UnaryOperation>
+OutputIterator transform(threadpool<strategy> &pool, InputIterator first, InputIterator last, OutputIterator d_first,
+                         UnaryOperation op, const schedule &policy = schedule::blocks())
+{
+    size_t size = (size_t)std::distance(first, last);
+    pool.parallelize(
+        (size_t)0, size,
+        [&](size_t begin, size_t end) {
+            std::transform(first + begin, first + end, d_first + begin, op);
+        },
+        policy);
+    return d_first + size;
+}
+
+/**
+ * @brief Fold transform(x) of every element with reduce, starting from init. Each block folds into its own partial,
+ * the partials are combined in block order, so reduce only needs to be associative.
+ */
+template <int strategy, typename Iterator, typename T, typename BinaryReduce, typename UnaryTransform>
+T transform_reduce(threadpool<strategy> &pool, Iterator first, Iterator last, T init, BinaryReduce reduce,
+                   UnaryTransform transform)
+{
+    size_t size = (size_t)std::distance(first, last);
+    if (size == 0) return init;
+    size_t blocks = __block_count(pool, size);
+    std::vector<std::optional<T>> partials(blocks);
+    __for_blocks(pool, size, blocks, [&](size_t b, size_t begin, size_t end) {
+        T partial = transform(first[begin]);
+        for (size_t i = begin + 1; i < end; i++) {
+            partial = reduce(std::move(partial), transform(first[i]));
+        }
+        partials[b].emplace(std::move(partial));
+    });
+    for (auto &partial : partials) {
+        init = reduce(std::move(init), std::move(*partial));
+    }
+    return init;
+}
+
+template <int strategy, typename Iterator, typename T, typename BinaryOperation = std::plus<>>
+T reduce(threadpool<strategy> &pool, Iterator first, Iterator last, T init, BinaryOperation op = {})
+{
+    return algorithms::transform_reduce(pool, first, last, std::move(init), op, [](const auto &value) -> const auto & {
+        return value;
+    });
+}
+
+/**
+ * @brief Write the running op-fold of [first, last) to d_first, which may equal first. Three passes: the blocks are
+ * reduced in parallel, their totals are scanned serially, and the blocks are scanned in parallel from their offsets.
+ */
+template <int strategy, typename InputIterator, typename OutputIterator, typename BinaryOperation = std::plus<>>
+OutputIterator inclusive_scan(threadpool<strategy> &pool, InputIterator first, InputIterator last,
+                              OutputIterator d_first, BinaryOperation op = {})
+{
+    typedef typename std::iterator_traits<InputIterator>::value_type T;
+    size_t size = (size_t)std::distance(first, last);
+    if (size == 0) return d_first;
+    size_t blocks = __block_count(pool, size);
+    std::vector<std::optional<T>> totals(blocks);
+    __for_blocks(pool, size, blocks, [&](size_t b, size_t begin, size_t end) {
+        T total = first[begin];
+        for (size_t i = begin + 1; i < end; i++) {
+            total = op(std::move(total), first[i]);
+        }
+        totals[b].emplace(std::move(total));
+    });
+    for (size_t b = 1; b < blocks; b++) {
+        totals[b] = op(*totals[b - 1], std::move(*totals[b]));
+    }
+    __for_blocks(pool, size, blocks, [&](size_t b, size_t begin, size_t end) {
+        T running = b == 0 ? T(first[begin]) : op(*totals[b - 1], first[begin]);
+        d_first[begin] = running;
+        for (size_t i = begin + 1; i < end; i++) {
+            running = op(std::move(running), first[i]);
+            d_first[i] = running;
+        }
+    });
+    return d_first + size;
+}
+
+/**
+ * @brief Merge sort: the blocks are sorted in parallel, then merged pairwise in parallel rounds. Not stable.
+ */
+template <int strategy, typename Iterator, typename Compare = std::less<>>
+void sort(threadpool<strategy> &pool, Iterator first, Iterator last, Compare comp = {})
+{
+    size_t size = (size_t)std::distance(first, last);
+    size_t blocks = __block_count(pool, size / 2);
+    if (blocks < 2) {
+        std::sort(first, last, comp);
+        return;
+    }
+    __for_blocks(pool, size, blocks, [&](size_t, size_t begin, size_t end) {
+        std::sort(first + begin, first + end, comp);
+    });
+    for (size_t width = 1; width < blocks; width *= 2) {
+        size_t pairs = (blocks + 2 * width - 1) / (2 * width);
+        pool.parallelize(
+            (size_t)0, pairs,
+            [&](size_t first_pair, size_t last_pair) {
+                for (size_t p = first_pair; p < last_pair; p++) {
+                    size_t left = 2 * width * p, middle = left + width, right = std::min(middle + width, blocks);
+                    if (middle >= blocks) continue;
+                    std::inplace_merge(first + size * left / blocks, first + size * middle / blocks,
+                                       first + size * right / blocks, comp);
+                }
+            },
+            pairs);
+    }
+}
+} // namespace algorithms
+
+#if defined(THREADPOOL_COROUTINES)
+template <typename T = void>
+class task;
+
+/* shared by the promises of task<T>: lazy start, and the awaiting coroutine resumed at the end */
+struct __task_promise_base {
+    struct final_awaiter {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+        {
+            std::coroutine_handle<> next = finished.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+    final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct __task_promise : __task_promise_base {
+    task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U &&value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+    T get()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template <>
+struct __task_promise<void> : __task_promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void get()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+/**
+ * @brief Lazy coroutine returning T. It starts when awaited, and the awaiting coroutine resumes on the thread that
+ * finishes it, a worker once the body has done co_await pool.schedule(). Use sync_wait() to run one from a normal
+ * function, and when_all()/when_any() to run several at once.
+ */
+template <typename T>
+class task {
+  public:
+    using promise_type = __task_promise<T>;
+
+    task() noexcept = default;
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+    task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    task &operator=(task &&other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    ~task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool valid() const noexcept
+    {
+        return static_cast<bool>(handle);
+    }
+
+    bool await_ready() const noexcept
+    {
+        return handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        return handle.promise().get();
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+task<T> __task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<__task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> __task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<__task_promise<void>>::from_promise(*this));
+}
+
+/* eager, self-destroying coroutine used to drive tasks from sync_wait(), when_all() and when_any() */
+struct __detached_task {
+    struct promise_type {
+        __detached_task get_return_object() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
 };
+
+/* results of the tasks given to when_all() or when_any(), kept alive by the tasks still running */
+template <typename T>
+struct __when_state {
+    explicit __when_state(size_t size) : results(size), errors(size) {}
+
+    std::vector<std::optional<std::conditional_t<std::is_void_v<T>, bool, T>>> results;
+    std::vector<std::exception_ptr> errors;
+    std::coroutine_handle<> continuation;
+    std::atomic<size_t> pending = 0;            /* when_all: running tasks, plus one until the awaiter has suspended */
+    std::atomic<size_t> winner = SIZE_MAX;      /* when_any: first task to finish */
+    std::atomic<uint32_t> resumers = 0;         /* when_any: the winner and the awaiter, the second one resumes */
+};
+
+template <typename T, typename Arrive>
+__detached_task __when_drive(task<T> t, std::shared_ptr<__when_state<T>> state, size_t index, Arrive arrive)
+{
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await t;
+            state->results[index].emplace(true);
+        } else {
+            state->results[index].emplace(co_await t);
+        }
+    } catch (...) {
+        state->errors[index] = std::current_exception();
+    }
+    arrive(*state, index);
+}
+
+/**
+ * @brief Run t to completion from a thread that is not a worker, blocking until it is done.
+ */
+template <typename T>
+T sync_wait(task<T> t)
+{
+    struct waiter {
+        std::atomic<uint32_t> done = 0;
+        std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<waiter>();
+    [](task<T> t, std::shared_ptr<waiter> state) -> __detached_task {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await t;
+                state->result.emplace(true);
+            } else {
+                state->result.emplace(co_await t);
+            }
+        } catch (...) {
+            state->error = std::current_exception();
+        }
+        atomic_unpark(state->done, INT_MAX);
+    }(std::move(t), state);
+    while (state->done.load(std::memory_order_acquire) == 0) {
+        atomic_park(state->done, 0);
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*state->result);
+    }
+}
+
+/**
+ * @brief Start all tasks and resume once every one has finished, with their results in order. The first exception in
+ * order is rethrown, after all tasks have finished.
+ */
+template <typename T>
+task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<task<T>> tasks)
+{
+    using state_type = __when_state<T>;
+    struct awaiter {
+        bool await_ready() const noexcept
+        {
+            return tasks.empty();
+        }
+        bool await_suspend(std::coroutine_handle<> awaiting)
+        {
+            state->continuation = awaiting;
+            state->pending = tasks.size() + 1;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                __when_drive(std::move(tasks[i]), state, i, [](state_type &s, size_t) {
+                    if (s.pending.fetch_sub(1) == 1) {
+                        s.continuation.resume();
+                    }
+                });
+            }
+            return state->pending.fetch_sub(1) != 1;
+        }
+        void await_resume() const noexcept {}
+
+        std::vector<task<T>> &tasks;
+        std::shared_ptr<state_type> &state; /* by reference: gcc 12 destroys awaiter temporaries twice */
+    };
+
+    auto state = std::make_shared<state_type>(tasks.size());
+    co_await awaiter{tasks, state};
+    for (auto &error : state->errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if constexpr (std::is_void_v<T>) {
+        co_return;
+    } else {
+        std::vector<T> values;
+        values.reserve(state->results.size());
+        for (auto &result : state->results) {
+            values.push_back(std::move(*result));
+        }
+        co_return values;
+    }
+}
+
+/**
+ * @brief Start the tasks in order until one finishes, and resume with its index (and result), rethrowing its
+ * exception. Tasks already started keep running on their own, tasks not started yet are dropped.
+ */
+template <typename T>
+task<std::conditional_t<std::is_void_v<T>, size_t, std::pair<size_t, T>>> when_any(std::vector<task<T>> tasks)
+{
+    using state_type = __when_state<T>;
+    struct awaiter {
+        bool await_ready() const noexcept
+        {
+            return tasks.empty();
+        }
+        bool await_suspend(std::coroutine_handle<> awaiting)
+        {
+            state->continuation = awaiting;
+            for (size_t i = 0; i < tasks.size() && state->winner == SIZE_MAX; i++) {
+                __when_drive(std::move(tasks[i]), state, i, [](state_type &s, size_t index) {
+                    size_t none = SIZE_MAX;
+                    if (s.winner.compare_exchange_strong(none, index) && s.resumers.fetch_add(1) == 1) {
+                        s.continuation.resume();
+                    }
+                });
+            }
+            return state->resumers.fetch_add(1) == 0;
+        }
+        void await_resume() const noexcept {}
+
+        std::vector<task<T>> &tasks;
+        std::shared_ptr<state_type> &state; /* by reference: gcc 12 destroys awaiter temporaries twice */
+    };
+
+    if (tasks.empty()) {
+        throw std::invalid_argument("when_any needs at least one task");
+    }
+    auto state = std::make_shared<state_type>(tasks.size());
+    co_await awaiter{tasks, state};
+    size_t index = state->winner;
+    if (state->errors[index]) {
+        std::rethrow_exception(state->errors[index]);
+    }
+    if constexpr (std::is_void_v<T>) {
+        co_return index;
+    } else {
+        co_return std::pair<size_t, T>(index, std::move(*state->results[index]));
+    }
+}
+#endif
 } // namespace multiprocessing